@@ -0,0 +1,433 @@
+//
+//  format_bench.cpp
+//  std-format
+//
+//  Created by knejp on 11.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+/*
+ Measures the time and heap allocations per call of the various ways to format a string.
+
+ Every case formats the same arguments through format() into a new string, format(in_place, ...) into each kind of
+ destination supported by format_appender, a precompiled formatter, the format cache, formatted_size(), and for
+ comparison through snprintf() and ostringstream.
+
+ Usage: format_bench [--iterations N] [--filter substring]
+
+ Results are written to stdout as JSON:
+ { "benchmarks": [ { "case": ..., "method": ..., "iterations": ..., "ns_per_op": ..., "allocs_per_op": ..., "bytes_per_op": ..., "output_size": ... }, ... ] }
+ */
+
+#include <std-format/format.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace experimental;
+
+////////////////////////////////////////////////////////////////////////////
+// Allocation counting
+
+namespace
+{
+	atomic<size_t> allocations{0};
+	atomic<size_t> allocated_bytes{0};
+}
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, memory_order_relaxed);
+	allocated_bytes.fetch_add(size, memory_order_relaxed);
+	if(auto p = malloc(size ? size : 1))
+		return p;
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	try { return operator new(size); }
+	catch(...) { return nullptr; }
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept { return operator new(size, nothrow); }
+// Every form forwards to the unsized operator delete, so the only malloc/free pair is in operator new and operator delete.
+// It is kept out of line, otherwise GCC sees free() called on memory from operator new after inlining both and warns about a mismatch.
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+////////////////////////////////////////////////////////////////////////////
+// A custom type with its own format flags
+
+namespace bench
+{
+	struct point
+	{
+		int x;
+		int y;
+	};
+
+	struct point_style
+	{
+		bool parens;
+	};
+
+	// "p" surrounds the coordinates with parentheses
+	template<class CharT, class Traits>
+	point_style parse_format_flags(format_tag<point>, basic_string_view<CharT, Traits> flags)
+	{
+		return { flags.size() == 1 && flags.data()[0] == CharT('p') };
+	}
+
+	template<class Sink>
+	size_t to_string(const point& p, format_appender<Sink>& app, const point_style& style)
+	{
+		format_spec<char> spec;
+		size_t n = 0;
+		if(style.parens)
+		{
+			app.append('(');
+			++n;
+		}
+		n += to_string(p.x, app, spec);
+		app.append(", ", 2);
+		n += 2;
+		n += to_string(p.y, app, spec);
+		if(style.parens)
+		{
+			app.append(')');
+			++n;
+		}
+		return n;
+	}
+
+	ostream& operator<< (ostream& os, const point& p)
+	{
+		return os << '(' << p.x << ", " << p.y << ')';
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Cases
+
+namespace bench
+{
+	/*
+	 Every case provides the format string and its arguments through apply(), and the equivalent snprintf() and
+	 ostream code for comparison.
+	 */
+
+	struct integers
+	{
+		static constexpr const char* name = "integers";
+		int a = 42, b = -1234567, c = 0;
+		long long d = 9876543210123LL;
+
+		template<class F>
+		void apply(F f) const { f("{0} {1} {2} {3}", a, b, c, d); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "%d %d %d %lld", a, b, c, d); }
+		void stream(ostream& os) const { os << a << ' ' << b << ' ' << c << ' ' << d; }
+	};
+
+	struct floats
+	{
+		static constexpr const char* name = "floats";
+		double a = 3.14159265358979, b = -0.001234, c = 6.02214076e23;
+
+		template<class F>
+		void apply(F f) const { f("{0} {1:.3f} {2:e}", a, b, c); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "%.17g %.3f %e", a, b, c); }
+		void stream(ostream& os) const
+		{
+			os.precision(17);
+			os << a << ' ';
+			os << fixed;
+			os.precision(3);
+			os << b << ' ';
+			os << scientific;
+			os.precision(6);
+			os << c;
+		}
+	};
+
+	struct strings
+	{
+		static constexpr const char* name = "strings";
+		string a = "user", b = "logged in from", c = "203.0.113.7";
+
+		template<class F>
+		void apply(F f) const { f("{0} {1} {2}", a, b, c); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "%s %s %s", a.c_str(), b.c_str(), c.c_str()); }
+		void stream(ostream& os) const { os << a << ' ' << b << ' ' << c; }
+	};
+
+	struct mixed
+	{
+		static constexpr const char* name = "mixed";
+		int id = 1337;
+		double load = 0.8125;
+		string host = "db-replica-03";
+		point where = { 12, -7 };
+
+		template<class F>
+		void apply(F f) const { f("[{0}] host={2} load={1:.2f} at {3:p}", id, load, host, where); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "[%d] host=%s load=%.2f at (%d, %d)", id, host.c_str(), load, where.x, where.y); }
+		void stream(ostream& os) const
+		{
+			os << '[' << id << "] host=" << host << " load=";
+			os << fixed;
+			os.precision(2);
+			os << load << " at " << where;
+		}
+	};
+
+	struct aligned
+	{
+		static constexpr const char* name = "aligned";
+		int a = 42;
+		string b = "name";
+		double c = 2.5;
+
+		template<class F>
+		void apply(F f) const { f("|{0,10}|{1,-8}|{2,12:.2f}|", a, b, c); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "|%10d|%-8s|%12.2f|", a, b.c_str(), c); }
+		void stream(ostream& os) const
+		{
+			os << '|' << setw(10) << a << '|' << left << setw(8) << b << '|' << right << fixed;
+			os.precision(2);
+			os << setw(12) << c << '|';
+		}
+	};
+
+	// Note that a closing brace directly following an argument would be read as part of its flags
+	struct escaped
+	{
+		static constexpr const char* name = "escaped";
+		int id = 7;
+		string name_ = "widget";
+		int t1 = 3, t2 = 4;
+
+		template<class F>
+		void apply(F f) const { f("{{\"id\": {0}, \"name\": \"{1}\", \"tags\": [{{ \"a\": {2} }}, {{ \"b\": {3} }}], \"meta\": {{}}}}", id, name_, t1, t2); }
+		int print(char* buf, size_t n) const { return snprintf(buf, n, "{\"id\": %d, \"name\": \"%s\", \"tags\": [{ \"a\": %d }, { \"b\": %d }], \"meta\": {}}", id, name_.c_str(), t1, t2); }
+		void stream(ostream& os) const { os << "{\"id\": " << id << ", \"name\": \"" << name_ << "\", \"tags\": [{ \"a\": " << t1 << " }, { \"b\": " << t2 << " }], \"meta\": {}}"; }
+	};
+
+	constexpr const char* integers::name;
+	constexpr const char* floats::name;
+	constexpr const char* strings::name;
+	constexpr const char* mixed::name;
+	constexpr const char* aligned::name;
+	constexpr const char* escaped::name;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Driver
+
+namespace bench
+{
+	struct options
+	{
+		size_t iterations = 200000;
+		string filter;
+	};
+
+	struct result
+	{
+		string test_case;
+		string method;
+		size_t iterations;
+		double ns_per_op;
+		double allocs_per_op;
+		double bytes_per_op;
+		size_t output_size;
+	};
+
+	// Prevents the compiler from discarding the formatted output
+	volatile size_t sink;
+
+	class runner
+	{
+	public:
+		explicit runner(options opts) : _opts(move(opts)) { }
+
+		/// Run \p f, which returns the size of its output, for the configured number of iterations.
+		template<class F>
+		void run(const char* test_case, const char* method, F f)
+		{
+			auto full_name = string(test_case) + "/" + method;
+			if(!_opts.filter.empty() && full_name.find(_opts.filter) == string::npos)
+				return;
+
+			size_t output_size = 0;
+			for(size_t i = 0; i < _opts.iterations / 10 + 1; ++i) // Warm up caches and allocators
+				output_size = f();
+
+			auto allocs_before = allocations.load();
+			auto bytes_before = allocated_bytes.load();
+			auto start = chrono::steady_clock::now();
+			size_t total = 0;
+			for(size_t i = 0; i < _opts.iterations; ++i)
+				total += f();
+			auto stop = chrono::steady_clock::now();
+			sink = total;
+
+			auto n = static_cast<double>(_opts.iterations);
+			auto ns = chrono::duration<double, nano>(stop - start).count();
+			_results.push_back({ test_case, method, _opts.iterations, ns / n,
+				(allocations.load() - allocs_before) / n, (allocated_bytes.load() - bytes_before) / n, output_size });
+		}
+
+		void write_json(ostream& os) const
+		{
+			os << "{\n\t\"benchmarks\": [";
+			auto first = true;
+			for(const auto& r : _results)
+			{
+				os << (first ? "\n" : ",\n");
+				first = false;
+				char buf[512];
+				snprintf(buf, sizeof(buf), "\t\t{ \"case\": \"%s\", \"method\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f, \"output_size\": %zu }",
+					r.test_case.c_str(), r.method.c_str(), r.iterations, r.ns_per_op, r.allocs_per_op, r.bytes_per_op, r.output_size);
+				os << buf;
+			}
+			os << "\n\t]\n}\n";
+		}
+
+	private:
+		options _opts;
+		vector<result> _results;
+	};
+
+	template<class Case>
+	void run_case(runner& r, const Case& c)
+	{
+		auto name = Case::name;
+		c.apply([&](const char* fmt, const auto&... args)
+		{
+			r.run(name, "format", [&] { return format(fmt, args...).size(); });
+
+			r.run(name, "format_exact_size", [&] { return format(exact_size, fmt, args...).size(); });
+
+			string str;
+			r.run(name, "in_place_string", [&]
+			{
+				str.clear();
+				format(in_place, str, fmt, args...);
+				return str.size();
+			});
+
+			vector<char> vec;
+			r.run(name, "in_place_back_inserter", [&]
+			{
+				vec.clear();
+				auto it = back_inserter(vec);
+				format(in_place, it, fmt, args...);
+				return vec.size();
+			});
+
+			array<char, 512> arr;
+			r.run(name, "in_place_array", [&]
+			{
+				auto app = make_format_appender(arr);
+				format(in_place, app, fmt, args...);
+				return app.write_count();
+			});
+
+			stringbuf buf;
+			r.run(name, "in_place_streambuf", [&]
+			{
+				buf.str(string());
+				format(in_place, buf, fmt, args...);
+				return static_cast<size_t>(buf.pubseekoff(0, ios_base::cur, ios_base::out));
+			});
+
+			r.run(name, "in_place_ostreambuf_iterator", [&]
+			{
+				buf.str(string());
+				auto it = ostreambuf_iterator<char>(&buf);
+				format(in_place, it, fmt, args...);
+				return static_cast<size_t>(buf.pubseekoff(0, ios_base::cur, ios_base::out));
+			});
+
+			r.run(name, "in_place_small_buffer", [&]
+			{
+				detail::small_buffer<char> small;
+				format(in_place, small, fmt, args...);
+				return small.size();
+			});
+
+			r.run(name, "formatted_size", [&] { return formatted_size(fmt, args...); });
+
+			svformatter<typename decay<decltype(args)>::type...> formatter{fmt};
+			r.run(name, "formatter", [&] { return formatter(args...).size(); });
+			r.run(name, "formatter_in_place_string", [&]
+			{
+				str.clear();
+				formatter(str, args...);
+				return str.size();
+			});
+
+			auto& cache = format_cache::local();
+			cache.set_capacity(16);
+			r.run(name, "format_cached", [&] { return format(fmt, args...).size(); });
+			cache.set_capacity(0);
+		});
+
+		r.run(name, "snprintf", [&]
+		{
+			char buf[512];
+			return static_cast<size_t>(c.print(buf, sizeof(buf)));
+		});
+
+		r.run(name, "ostringstream", [&]
+		{
+			ostringstream os;
+			c.stream(os);
+			return os.str().size();
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::options opts;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			opts.iterations = strtoul(argv[++i], nullptr, 10);
+		else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			opts.filter = argv[++i];
+		else
+		{
+			cerr << "usage: " << argv[0] << " [--iterations N] [--filter substring]\n";
+			return 1;
+		}
+	}
+
+	bench::runner r{opts};
+	bench::run_case(r, bench::integers{});
+	bench::run_case(r, bench::floats{});
+	bench::run_case(r, bench::strings{});
+	bench::run_case(r, bench::mixed{});
+	bench::run_case(r, bench::aligned{});
+	bench::run_case(r, bench::escaped{});
+	r.write_json(cout);
+}
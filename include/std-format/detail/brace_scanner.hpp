@@ -0,0 +1,146 @@
+//
+//  brace_scanner.hpp
+//  std-format
+//
+//  Created by knejp on 7.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_brace_scanner_hpp
+#define std_format_detail_brace_scanner_hpp
+
+#include <std-format/detail/format_syntax.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STD_FORMAT_BRACE_SCANNER_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Runtime search for the next brace in a format string.
+// Format strings typically consist of long runs of static text with only a few arguments in between.
+// For narrow strings the scan is therefore done in blocks of 32 (AVX2), 16 (SSE2) or 8 (SWAR) characters at a time.
+// Everything else uses the constexpr find_brace() of the grammar core.
+// The grammar functions of format_syntax.hpp take block_brace_search to use this scan when called at runtime.
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		template<class CharT, class Traits, class Iter>
+		Iter scan_brace(Iter first, Iter last);
+
+		template<>
+		inline const char* scan_brace<char, char_traits<char>, const char*>(const char* first, const char* last);
+
+		/// Runtime replacement for constexpr_brace_search.
+		struct block_brace_search
+		{
+			template<class CharT, class Traits, class Iter>
+			static Iter find(Iter first, Iter last) { return scan_brace<CharT, Traits>(first, last); }
+		};
+
+		/// Call `f(chunk)` for every contiguous chunk of the unescaped format flags \p flags.
+		/// Every brace in the flags is followed by its duplicate, thus a chunk ends after the first brace of a pair and the duplicate is skipped.
+		template<class CharT, class Traits, class F>
+		void for_each_unescaped(basic_string_view<CharT, Traits> flags, F f)
+		{
+			auto first = flags.begin();
+			auto last = flags.end();
+			while(first != last)
+			{
+				auto brace = scan_brace<CharT, Traits>(first, last);
+				if(brace == last)
+				{
+					f(basic_string_view<CharT, Traits>{ first, last });
+					return;
+				}
+				f(basic_string_view<CharT, Traits>{ first, brace + 1 });
+				first = brace + 2;
+			}
+		}
+
+		inline unsigned count_trailing_zeros(uint32_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+		}
+
+		/// Returns a word with the highest bit set in every byte of \p x which is zero.
+		/// Unlike the well known has-zero-byte trick this has no false positives due to borrows into higher bytes.
+		inline uint64_t zero_bytes(uint64_t x)
+		{
+			constexpr uint64_t low7 = 0x7F7F7F7F7F7F7F7Fu;
+			return ~(((x & low7) + low7) | x | low7);
+		}
+
+		/// Returns a word with the highest bit set in every byte of \p block which is equal to '{' or '}'.
+		inline uint64_t brace_bytes(uint64_t block)
+		{
+			constexpr uint64_t ones = 0x0101010101010101u;
+			return zero_bytes(block ^ (ones * '{')) | zero_bytes(block ^ (ones * '}'));
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+template<class CharT, class Traits, class Iter>
+Iter std::experimental::detail::scan_brace(Iter first, Iter last)
+{
+	return find_brace<CharT, Traits>(first, last);
+}
+
+template<>
+inline const char* std::experimental::detail::scan_brace<char, std::char_traits<char>, const char*>(const char* first, const char* last)
+{
+#if defined(__AVX2__)
+	const auto open32 = _mm256_set1_epi8('{');
+	const auto close32 = _mm256_set1_epi8('}');
+	for( ; last - first >= 32; first += 32)
+	{
+		auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+		auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(block, open32), _mm256_cmpeq_epi8(block, close32));
+		auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+		if(mask != 0)
+			return first + count_trailing_zeros(mask);
+	}
+#endif
+#if defined(__AVX2__) || defined(STD_FORMAT_BRACE_SCANNER_SSE2)
+	const auto open16 = _mm_set1_epi8('{');
+	const auto close16 = _mm_set1_epi8('}');
+	for( ; last - first >= 16; first += 16)
+	{
+		auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		auto matches = _mm_or_si128(_mm_cmpeq_epi8(block, open16), _mm_cmpeq_epi8(block, close16));
+		auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+		if(mask != 0)
+			return first + count_trailing_zeros(mask);
+	}
+#endif
+	// Portable fallback and the remaining tail, the exact position within a block is found by the scalar loop below
+	for( ; last - first >= 8; first += 8)
+	{
+		uint64_t block;
+		memcpy(&block, first, sizeof(block));
+		if(brace_bytes(block) != 0)
+			break;
+	}
+	return find_brace<char, char_traits<char>>(first, last);
+}
+
+#undef STD_FORMAT_BRACE_SCANNER_SSE2
+
+#endif // std_format_detail_brace_scanner_hpp
@@ -0,0 +1,167 @@
+//
+//  checked_format.hpp
+//  std-format
+//
+//  Created by knejp on 14.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_checked_format_hpp
+#define std_format_detail_checked_format_hpp
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		// Never called during constant evaluation, thus turning any call to it into a compile error containing the message.
+		// A string checked at runtime is formatted without any further checks, so it must never be used if it is malformed.
+		[[noreturn]] inline void invalid_checked_format(const char* message) { STD_FORMAT_THROW(runtime_error{message}); }
+
+		// Only the flags of the builtin arithmetic types have a constexpr parser, all other types receive theirs unchecked
+		template<class Arg>
+		using has_checked_flags = integral_constant<bool, is_format_integer<Arg>::value || is_floating_point<Arg>::value>;
+
+		template<class... Args>
+		struct checked_format_arguments
+		{
+			template<class CharT, class Traits>
+			static constexpr void check_flags(size_t, basic_string_view<CharT, Traits>) { }
+		};
+
+		template<class Arg, class... Args>
+		struct checked_format_arguments<Arg, Args...>
+		{
+			/// Check \p flags against the type of the argument at \p index.
+			template<class CharT, class Traits>
+			static constexpr void check_flags(size_t index, basic_string_view<CharT, Traits> flags)
+			{
+				if(index == 0)
+					check_flags(flags, has_checked_flags<Arg>());
+				else
+					checked_format_arguments<Args...>::check_flags(index - 1, flags);
+			}
+
+		private:
+			template<class CharT, class Traits>
+			static constexpr void check_flags(basic_string_view<CharT, Traits> flags, true_type) { parse_format_flags(format_tag<Arg>(), flags); }
+			template<class CharT, class Traits>
+			static constexpr void check_flags(basic_string_view<CharT, Traits>, false_type) { }
+		};
+
+		/// Check the syntax of [first, last), the indices against the number of arguments and the flags of the builtin arithmetic arguments.
+		/// Flags containing escaped braces are not checked.
+		template<class CharT, class Traits, class... Args>
+		constexpr void check_format_string(const CharT* first, const CharT* last)
+		{
+			auto iter = first;
+			while(iter != last)
+			{
+				auto brace = find_brace<CharT, Traits>(iter, last);
+				if(brace == last)
+					break;
+				if(is_escaped_brace<CharT, Traits>(brace, last))
+				{
+					iter = brace + 2;
+					continue;
+				}
+				auto arg = scan_format_argument<CharT, Traits>(brace, last, sizeof...(Args));
+				check_format_syntax(arg.status, invalid_checked_format);
+				if(!arg.flags_escaped)
+					checked_format_arguments<decay_t<Args>...>::check_flags(arg.index, basic_string_view<CharT, Traits>{ arg.flags_first, arg.flags_last });
+				iter = arg.pos;
+			}
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+////////////////////////////////////////////////////////////////////////////
+// basic_checked_format
+
+/**
+ A format string checked against the argument types \p Args while it is constructed.
+
+ The constructor is constexpr. In a constant expression a malformed string, an index out of bounds or invalid flags of an arithmetic argument is a compile error,
+ outside of one it throws runtime_error (or terminates without exceptions) and the string is never used.
+ Formatting can therefore skip all checks of the format string, it only looks for the braces and reads the indices and alignments without any error branches.
+ To guarantee the check happens during compilation construct it as a constexpr variable:
+ ```cpp
+ static constexpr checked_format<int, string> fmt{"{0,8}: {1}"};
+ auto str = format(fmt, 42, name);
+ ```
+ Only the address of the string is stored, it must outlive the object, which is always the case for string literals.
+ Mutable arrays are rejected, a constant array must end with a null character which is not part of the format string.
+ The arguments are converted to \p Args when formatting, so they should be given as the types actually passed.
+ */
+template<class CharT, class... Args>
+class std::experimental::basic_checked_format
+{
+public:
+	using value_type = CharT;
+	using traits_type = char_traits<CharT>;
+
+	/// \p str must be a string literal or another constant array ending with a null character, which is not part of the format string.
+	template<size_t N>
+	constexpr basic_checked_format(const CharT (&str)[N]) : _str(str), _size(N - 1)
+	{
+		if(!traits_type::eq(str[N - 1], CharT()))
+			detail::invalid_checked_format("Checked format string is not null-terminated.");
+		detail::check_format_string<CharT, traits_type, Args...>(_str, _str + _size);
+	}
+	/// Mutable arrays may change after they are checked.
+	template<size_t N>
+	basic_checked_format(CharT (&str)[N]) = delete;
+
+	/// Format literals have their syntax checked already, this adds the checks against \p Args.
+	template<CharT... Chars>
+	constexpr basic_checked_format(basic_format_literal<CharT, Chars...> lit) : _str(lit.data()), _size(lit.size())
+	{
+		detail::check_format_string<CharT, traits_type, Args...>(_str, _str + _size);
+	}
+
+	constexpr size_t size() const noexcept { return _size; }
+	constexpr const value_type* data() const noexcept { return _str; }
+
+	// Not implicit so the string is not parsed again by code taking any string convertible format source
+	explicit operator basic_string_view<value_type, traits_type>() const noexcept { return { _str, _size }; }
+
+	template<class Appender>
+	size_t operator() (Appender& app, const Args&... args) const
+	{
+		using table = detail::argument_table<Appender, CharT, traits_type, Args...>;
+		using flags_type = typename table::flags_type;
+
+		size_t printed = 0;
+
+		typename table::values_type values{ args... };
+		auto iter = _str;
+		auto last = _str + _size;
+		while(iter != last)
+		{
+			auto brace = detail::scan_brace<CharT, traits_type>(iter, last);
+			if(brace != iter)
+				app.append(iter, brace - iter);
+			if(brace == last)
+				break;
+			if(detail::is_escaped_brace<CharT, traits_type>(brace, last))
+			{
+				app.append(*brace);
+				iter = brace + 2;
+				continue;
+			}
+			auto arg = detail::scan_checked_argument<CharT, traits_type, detail::block_brace_search>(brace, last);
+			flags_type flags{ arg.flags_first, arg.flags_last };
+			if(arg.flags_escaped)
+				printed += table::format_escaped(app, values, arg.index, flags, arg.alignment);
+			else
+				printed += table::value[arg.index](app, values, nullptr, 0, flags, arg.alignment);
+			iter = arg.pos;
+		}
+		return printed;
+	}
+
+private:
+	const CharT* _str;
+	size_t _size;
+};
+
+#endif // std_format_detail_checked_format_hpp
@@ -0,0 +1,365 @@
+//
+//  deferred_format.hpp
+//  std-format
+//
+//  Created by knejp on 11.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_deferred_format_hpp
+#define std_format_detail_deferred_format_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		/*
+		 A record in a basic_deferred_buffer consists of a header followed by the captured format source and arguments.
+		 Every value is encoded by a codec providing:
+		 - `size_t measure(size_t offset, const T& x)`: the offset past \p x if it is stored at \p offset
+		 - `size_t store(unsigned char* record, size_t offset, const T& x)`: store \p x at \p offset and return the offset past it
+		 - `loaded_type load(const unsigned char* record, size_t& offset)`: decode the value at \p offset and advance it
+		 Offsets are relative to the start of the record which is aligned to deferred_record_alignment.
+		 */
+
+		constexpr size_t align_offset(size_t offset, size_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+		/// Trivially copyable values are copied bytewise.
+		template<class T>
+		struct deferred_value_codec
+		{
+			using loaded_type = T;
+
+			static size_t measure(size_t offset, const T&) { return offset + sizeof(T); }
+			static size_t store(unsigned char* record, size_t offset, const T& x)
+			{
+				memcpy(record + offset, &x, sizeof(T));
+				return offset + sizeof(T);
+			}
+			static T load(const unsigned char* record, size_t& offset)
+			{
+				typename aligned_storage<sizeof(T), alignof(T)>::type storage;
+				memcpy(&storage, record + offset, sizeof(T));
+				offset += sizeof(T);
+				return *reinterpret_cast<const T*>(&storage);
+			}
+		};
+
+		/// Strings are copied into the record and loaded as a view of the copy.
+		template<class CharT, class Traits>
+		struct deferred_string_codec
+		{
+			using loaded_type = basic_string_view<CharT, Traits>;
+
+			static size_t measure(size_t offset, basic_string_view<CharT, Traits> str)
+			{
+				return align_offset(offset + sizeof(size_t), alignof(CharT)) + str.size() * sizeof(CharT);
+			}
+			static size_t store(unsigned char* record, size_t offset, basic_string_view<CharT, Traits> str)
+			{
+				auto size = str.size();
+				memcpy(record + offset, &size, sizeof(size_t));
+				offset = align_offset(offset + sizeof(size_t), alignof(CharT));
+				if(size > 0)
+					memcpy(record + offset, str.data(), size * sizeof(CharT));
+				return offset + size * sizeof(CharT);
+			}
+			static loaded_type load(const unsigned char* record, size_t& offset)
+			{
+				size_t size;
+				memcpy(&size, record + offset, sizeof(size_t));
+				offset = align_offset(offset + sizeof(size_t), alignof(CharT));
+				auto str = reinterpret_cast<const CharT*>(record + offset);
+				offset += size * sizeof(CharT);
+				return { str, size };
+			}
+		};
+
+		/// Format strings are only referenced, their characters are not copied.
+		template<class CharT, class Traits>
+		struct deferred_view_codec
+		{
+			using loaded_type = basic_string_view<CharT, Traits>;
+
+			static size_t measure(size_t offset, basic_string_view<CharT, Traits>) { return offset + sizeof(const CharT*) + sizeof(size_t); }
+			static size_t store(unsigned char* record, size_t offset, basic_string_view<CharT, Traits> str)
+			{
+				auto data = str.data();
+				auto size = str.size();
+				memcpy(record + offset, &data, sizeof(data));
+				memcpy(record + offset + sizeof(data), &size, sizeof(size));
+				return offset + sizeof(data) + sizeof(size);
+			}
+			static loaded_type load(const unsigned char* record, size_t& offset)
+			{
+				const CharT* data;
+				size_t size;
+				memcpy(&data, record + offset, sizeof(data));
+				memcpy(&size, record + offset + sizeof(data), sizeof(size));
+				offset += sizeof(data) + sizeof(size);
+				return { data, size };
+			}
+		};
+
+		template<class T, class CharT, class Traits>
+		struct is_deferred_string : false_type { };
+		template<class CharT, class Traits, class Allocator>
+		struct is_deferred_string<basic_string<CharT, Traits, Allocator>, CharT, Traits> : true_type { };
+		template<class CharT, class Traits>
+		struct is_deferred_string<basic_string_view<CharT, Traits>, CharT, Traits> : true_type { };
+		template<class CharT, class Traits>
+		struct is_deferred_string<const CharT*, CharT, Traits> : true_type { };
+		template<class CharT, class Traits>
+		struct is_deferred_string<CharT*, CharT, Traits> : true_type { };
+
+		template<class T, class CharT, class Traits>
+		auto select_deferred_codec(int) -> typename enable_if<is_deferred_string<T, CharT, Traits>::value, deferred_string_codec<CharT, Traits>>::type;
+		template<class T, class CharT, class Traits>
+		auto select_deferred_codec(long) -> typename enable_if<is_trivially_copyable<T>::value, deferred_value_codec<T>>::type;
+		template<class T, class CharT, class Traits>
+		void select_deferred_codec(...);
+
+		template<class T, class CharT, class Traits>
+		using deferred_codec = decltype(select_deferred_codec<T, CharT, Traits>(0));
+
+		template<bool... B>
+		struct bool_pack;
+		
+		template<class CharT, class Traits, class... Args>
+		using are_deferrable = is_same<bool_pack<true, !is_void<deferred_codec<Args, CharT, Traits>>::value...>,
+			bool_pack<!is_void<deferred_codec<Args, CharT, Traits>>::value..., true>>;
+
+		// Format literals carry their format string in their type, everything else is referenced as a string view
+		template<class FormatSource, class CharT, class Traits>
+		using deferred_source_codec = typename conditional<is_empty<FormatSource>::value && is_trivially_copyable<FormatSource>::value,
+			deferred_value_codec<FormatSource>, deferred_view_codec<CharT, Traits>>::type;
+
+		/// Customization point: types which are neither trivially copyable nor strings may provide an overload
+		/// `U capture_format_argument(const T& x)` findable by ADL which converts \p x to a type \p U that can be captured and formatted in its place.
+		template<class T>
+		auto capture_argument(const T& x, int) -> decltype(capture_format_argument(x)) { return capture_format_argument(x); }
+		template<class T>
+		const T& capture_argument(const T& x, long) { return x; }
+
+		template<class T>
+		using captured_type = typename decay<decltype(capture_argument(declval<const T&>(), 0))>::type;
+
+		template<class CharT, class Traits>
+		using deferred_replay_function = void (*)(const unsigned char* record, basic_string<CharT, Traits>& out);
+
+		template<class CharT, class Traits>
+		struct deferred_record_header
+		{
+			deferred_replay_function<CharT, Traits> replay; // Null for padding at the end of the buffer
+			size_t size; // Including the header and alignment
+		};
+
+		// At least the size of a header, so the padding marker written at the end of the buffer always fits
+		constexpr size_t deferred_record_alignment = alignof(max_align_t) > sizeof(deferred_record_header<char, char_traits<char>>)
+			? alignof(max_align_t) : sizeof(deferred_record_header<char, char_traits<char>>);
+
+		template<class CharT, class Traits, class FormatSource, class... Args>
+		struct deferred_record
+		{
+			using header_type = deferred_record_header<CharT, Traits>;
+			using source_codec = deferred_source_codec<FormatSource, CharT, Traits>;
+
+			template<class Captured, size_t... I>
+			static size_t measure(const FormatSource& fmt, const Captured& captured, index_sequence<I...>)
+			{
+				auto offset = source_codec::measure(sizeof(header_type), fmt);
+				using expand = int[];
+				(void)expand{ 0, (offset = deferred_codec<Args, CharT, Traits>::measure(offset, get<I>(captured)), 0)... };
+				return align_offset(offset, deferred_record_alignment);
+			}
+
+			template<class Captured, size_t... I>
+			static void store(unsigned char* record, size_t size, const FormatSource& fmt, const Captured& captured, index_sequence<I...>)
+			{
+				header_type header{ &replay, size };
+				memcpy(record, &header, sizeof(header));
+				auto offset = source_codec::store(record, sizeof(header_type), fmt);
+				using expand = int[];
+				(void)expand{ 0, (offset = deferred_codec<Args, CharT, Traits>::store(record, offset, get<I>(captured)), 0)... };
+			}
+
+			static void replay(const unsigned char* record, basic_string<CharT, Traits>& out)
+			{
+				size_t offset = sizeof(header_type);
+				auto fmt = source_codec::load(record, offset);
+				// Braced initialization guarantees the values are loaded in order
+				tuple<typename deferred_codec<Args, CharT, Traits>::loaded_type...> values{ deferred_codec<Args, CharT, Traits>::load(record, offset)... };
+				replay(fmt, values, out, make_index_sequence<sizeof...(Args)>());
+			}
+
+			template<class Source, class Values, size_t... I>
+			static void replay(const Source& fmt, const Values& values, basic_string<CharT, Traits>& out, index_sequence<I...>)
+			{
+				format(in_place, out, fmt, get<I>(values)...);
+			}
+		};
+	} // namespace detail
+}} // namespace std::experimental
+
+////////////////////////////////////////////////////////////////////////////
+// basic_deferred_buffer
+
+/**
+ A single-producer single-consumer queue of captured format calls.
+
+ deferred_format() copies the arguments into a compact binary record in the buffer instead of formatting them.
+ A consumer, usually on a different thread, later formats the records in the order they were captured with consume().
+ This moves the cost of formatting off the producing thread, which only pays for copying the arguments.
+
+ The format string is *not* copied, it must outlive the record (string literals and format literals always do).
+ Trivially copyable arguments are copied bytewise and strings are copied into the record.
+ Other types must provide `capture_format_argument()` (see detail::capture_argument()).
+
+ Neither side takes a lock. Each producing thread should have its own buffer.
+ */
+template<class CharT, class Traits>
+class std::experimental::basic_deferred_buffer
+{
+public:
+	using value_type = CharT;
+	using traits_type = Traits;
+	using string_type = basic_string<CharT, Traits>;
+	using string_view_type = basic_string_view<CharT, Traits>;
+
+	/// \p capacity is rounded up to a power of two of at least deferred_record_alignment bytes.
+	explicit basic_deferred_buffer(size_t capacity);
+	basic_deferred_buffer(const basic_deferred_buffer&) = delete;
+	basic_deferred_buffer& operator= (const basic_deferred_buffer&) = delete;
+
+	size_t capacity() const noexcept { return _capacity; }
+	/// Whether there are no records waiting to be consumed.
+	bool empty() const noexcept { return _head.load(memory_order_acquire) == _tail.load(memory_order_acquire); }
+	/// The number of records rejected by deferred_format() because the buffer was full.
+	size_t dropped() const noexcept { return _dropped.load(memory_order_relaxed); }
+
+	/// Format all records captured so far in order and call `f(string_view_type)` for each of them.
+	/// Returns the number of records formatted. Must only be called by the consuming thread.
+	/// If formatting a record throws the record is discarded and the exception propagated.
+	template<class F>
+	size_t consume(F f);
+
+	/// Reserve \p size bytes for a record. Returns \p nullptr if there is not enough room. Used by deferred_format().
+	unsigned char* reserve(size_t size);
+	/// Make the record returned by the last call to reserve() visible to the consumer.
+	void publish();
+
+private:
+	using header_type = detail::deferred_record_header<CharT, Traits>;
+	static_assert(sizeof(header_type) <= detail::deferred_record_alignment, "A header must fit into the smallest record.");
+	static_assert((detail::deferred_record_alignment & (detail::deferred_record_alignment - 1)) == 0, "The record alignment must be a power of two.");
+
+	unique_ptr<unsigned char[]> _data;
+	size_t _capacity;
+	atomic<size_t> _head{0}; // Position of the next record to consume, only written by the consumer
+	atomic<size_t> _tail{0}; // Position past the last published record, only written by the producer
+	atomic<size_t> _dropped{0};
+	size_t _reserved = 0; // End of the record being written, only used by the producer
+	string_type _line; // Reused by the consumer for every record
+};
+
+template<class CharT, class Traits>
+std::experimental::basic_deferred_buffer<CharT, Traits>::basic_deferred_buffer(size_t capacity)
+{
+	_capacity = detail::deferred_record_alignment;
+	while(_capacity < capacity)
+		_capacity *= 2;
+	// The allocation is suitably aligned for any fundamental type
+	_data.reset(new unsigned char[_capacity]);
+}
+
+template<class CharT, class Traits>
+unsigned char* std::experimental::basic_deferred_buffer<CharT, Traits>::reserve(size_t size)
+{
+	// Records are multiples of the alignment and the capacity is a power of two of it, so a header always fits before the end
+	auto tail = _tail.load(memory_order_relaxed);
+	auto used = tail - _head.load(memory_order_acquire);
+	auto position = tail & (_capacity - 1);
+	auto padding = _capacity - position < size ? _capacity - position : 0;
+	if(size > _capacity || used + padding + size > _capacity)
+	{
+		_dropped.fetch_add(1, memory_order_relaxed);
+		return nullptr;
+	}
+	if(padding > 0)
+	{
+		// Mark the rest of the buffer as unused and start over at the front
+		header_type header{ nullptr, padding };
+		memcpy(_data.get() + position, &header, sizeof(header));
+		position = 0;
+	}
+	_reserved = tail + padding + size;
+	return _data.get() + position;
+}
+
+template<class CharT, class Traits>
+void std::experimental::basic_deferred_buffer<CharT, Traits>::publish()
+{
+	_tail.store(_reserved, memory_order_release);
+}
+
+template<class CharT, class Traits>
+template<class F>
+size_t std::experimental::basic_deferred_buffer<CharT, Traits>::consume(F f)
+{
+	size_t count = 0;
+	auto head = _head.load(memory_order_relaxed);
+	auto tail = _tail.load(memory_order_acquire);
+	while(head != tail)
+	{
+		auto record = _data.get() + (head & (_capacity - 1));
+		header_type header;
+		memcpy(&header, record, sizeof(header));
+		if(header.replay)
+		{
+			_line.clear();
+#if STD_FORMAT_EXCEPTIONS
+			try
+			{
+				header.replay(record, _line);
+			}
+			catch(...)
+			{
+				_head.store(head + header.size, memory_order_release);
+				throw;
+			}
+#else
+			header.replay(record, _line);
+#endif
+			f(string_view_type{ _line.data(), _line.size() });
+			++count;
+		}
+		head += header.size;
+		_head.store(head, memory_order_release);
+	}
+	return count;
+}
+
+template<class CharT, class Traits, class FormatSource, class... Args>
+bool std::experimental::deferred_format(basic_deferred_buffer<CharT, Traits>& buffer, const FormatSource& fmt, const Args&... args)
+{
+	using record_type = detail::deferred_record<CharT, Traits, FormatSource, detail::captured_type<Args>...>;
+	static_assert(is_same<detail::char_type<FormatSource>, CharT>::value, "Character type of the format string does not match the buffer.");
+	static_assert(detail::are_deferrable<CharT, Traits, detail::captured_type<Args>...>::value,
+		"Argument cannot be captured, it must be trivially copyable, a string or provide capture_format_argument().");
+
+	tuple<decltype(detail::capture_argument(args, 0))...> captured{ detail::capture_argument(args, 0)... };
+	auto indices = make_index_sequence<sizeof...(Args)>();
+	auto size = record_type::measure(fmt, captured, indices);
+	auto record = buffer.reserve(size);
+	if(!record)
+		return false;
+	record_type::store(record, size, fmt, captured, indices);
+	buffer.publish();
+	return true;
+}
+
+#endif // std_format_detail_deferred_format_hpp
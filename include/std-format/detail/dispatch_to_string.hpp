@@ -20,10 +20,36 @@ namespace std { namespace experimental
 		using std::to_string;
 		using std::experimental::to_string;
 		
+		// Overloads returning a string may accept `(allocator_arg, alloc)` last to allocate it with the allocator of the destination.
+		// The allocator is passed as returned by the sink and may need rebinding.
+		template<class Arg, class Appender>
+		auto to_string_temp(int, const Arg& arg, const Appender& app)
+			-> decltype(to_string(arg, allocator_arg, sink_allocator(app, 0)))
+		{
+			return to_string(arg, allocator_arg, sink_allocator(app, 0));
+		}
+		template<class Arg, class Appender>
+		auto to_string_temp(long, const Arg& arg, const Appender&) -> decltype(to_string(arg))
+		{
+			return to_string(arg);
+		}
+		
+		template<class Arg, class Appender, class FmtFlags>
+		auto to_string_temp(int, const Arg& arg, const FmtFlags& flags, const Appender& app)
+			-> decltype(to_string(arg, flags, allocator_arg, sink_allocator(app, 0)))
+		{
+			return to_string(arg, flags, allocator_arg, sink_allocator(app, 0));
+		}
+		template<class Arg, class Appender, class FmtFlags>
+		auto to_string_temp(long, const Arg& arg, const FmtFlags& flags, const Appender&) -> decltype(to_string(arg, flags))
+		{
+			return to_string(arg, flags);
+		}
+		
 		// Single argument overload returning a string without options
 		template<class Arg, class Appender, class FmtFlags>
 		using overload1_sig =
-			decltype(to_string(declval<const Arg&>()));
+			decltype(to_string_temp(0, declval<const Arg&>(), declval<const Appender&>()));
 		
 		template<class Arg, class Appender, class FmtFlags>
 		true_type has_overload1(enable_for<overload1_sig<Arg, Appender, FmtFlags>>*) { return { }; }
@@ -34,7 +60,7 @@ namespace std { namespace experimental
 		// Single argument overload returning a string with options
 		template<class Arg, class Appender, class FmtFlags>
 		using overload1_opt_sig =
-			decltype(to_string(declval<const Arg&>(), declval<FmtFlags>()));
+			decltype(to_string_temp(0, declval<const Arg&>(), declval<FmtFlags>(), declval<const Appender&>()));
 		
 		template<class Arg, class Appender, class FmtFlags>
 		true_type has_overload1_opt(enable_for<overload1_opt_sig<Arg, Appender, FmtFlags>>*) { return { }; }
@@ -69,66 +95,91 @@ namespace std { namespace experimental
 		// Within each group (with or without format options) overloads are sorted by (possible) efficiency of signature.
 		template<class Arg, class Appender, class FmtFlags, bool b1, bool b2, bool b3>
 		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags flags,
-								  integral_constant<bool, true> has_overload2_opt,
-								  integral_constant<bool, b1> has_overload1_opt,
-								  integral_constant<bool, b2> has_overload2,
-								  integral_constant<bool, b3> has_overload1)
+								  integral_constant<bool, true> /*has_overload2_opt*/,
+								  integral_constant<bool, b1> /*has_overload1_opt*/,
+								  integral_constant<bool, b2> /*has_overload2*/,
+								  integral_constant<bool, b3> /*has_overload1*/)
 		{
 			return to_string(arg, app, flags);
 		}
 		
 		template<class Arg, class Appender, class FmtFlags, bool b1, bool b2>
 		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags flags,
-								  integral_constant<bool, false> has_overload2_opt,
-								  integral_constant<bool, true> has_overload1_opt,
-								  integral_constant<bool, b1> has_overload2,
-								  integral_constant<bool, b2> has_overload1)
+								  integral_constant<bool, false> /*has_overload2_opt*/,
+								  integral_constant<bool, true> /*has_overload1_opt*/,
+								  integral_constant<bool, b1> /*has_overload2*/,
+								  integral_constant<bool, b2> /*has_overload1*/)
 		{
-			auto string = to_string(arg, flags);
+			auto string = to_string_temp(0, arg, flags, app);
 			app.append(string);
 			return string.size();
 		}
 		
 		// Below do not accept format arguments
 		template<class Arg, class Appender, class FmtFlags, bool b1>
-		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags flags,
-								  integral_constant<bool, false> has_overload2_opt,
-								  integral_constant<bool, false> has_overload1_opt,
-								  integral_constant<bool, true> has_overload2,
-								  integral_constant<bool, b1> has_overload1)
+		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags,
+								  integral_constant<bool, false> /*has_overload2_opt*/,
+								  integral_constant<bool, false> /*has_overload1_opt*/,
+								  integral_constant<bool, true> /*has_overload2*/,
+								  integral_constant<bool, b1> /*has_overload1*/)
 		{
 			return to_string(arg, app);
 		}
 		
 		template<class Arg, class Appender, class FmtFlags>
-		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags flags,
-								  integral_constant<bool, false> has_overload2_opt,
-								  integral_constant<bool, false> has_overload1_opt,
-								  integral_constant<bool, false> has_overload2,
-								  integral_constant<bool, true> has_overload1)
+		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags,
+								  integral_constant<bool, false> /*has_overload2_opt*/,
+								  integral_constant<bool, false> /*has_overload1_opt*/,
+								  integral_constant<bool, false> /*has_overload2*/,
+								  integral_constant<bool, true> /*has_overload1*/)
 		{
-			auto string = to_string(arg);
+			auto string = to_string_temp(0, arg, app);
 			app.append(string);
 			return string.size();
 		}
 		
 		// There is no to_string for basic_string and basic_string_view, handle it internally
 		template<class CharT, class Traits, class Appender, class FmtFlags>
-		size_t dispatch_to_string(const basic_string<CharT, Traits>& arg, Appender& app, FmtFlags flags)
+		size_t dispatch_to_string(const basic_string<CharT, Traits>& arg, Appender& app, FmtFlags)
 		{
 			app.append(arg);
 			return arg.size();
 		}
 		
 		template<class CharT, class Traits, class Appender, class FmtFlags>
-		size_t dispatch_to_string(const basic_string_view<CharT, Traits>& arg, Appender& app, FmtFlags flags)
+		size_t dispatch_to_string(const basic_string_view<CharT, Traits>& arg, Appender& app, FmtFlags)
 		{
 			app.append(arg);
 			return arg.size();
 		}
 		
+		// Format flags are passed to parse_format_flags() if an overload for the argument type is findable by ADL, otherwise they are passed on as they are.
+		template<class Arg, class CharT, class Traits>
+		auto parse_flags_impl(int, basic_string_view<CharT, Traits> flags) -> decltype(parse_format_flags(format_tag<Arg>(), flags))
+		{
+			return parse_format_flags(format_tag<Arg>(), flags);
+		}
+		
+		template<class Arg, class CharT, class Traits>
+		basic_string_view<CharT, Traits> parse_flags_impl(long, basic_string_view<CharT, Traits> flags)
+		{
+			return flags;
+		}
+		
+		template<class Arg, class CharT, class Traits>
+		auto parse_flags(basic_string_view<CharT, Traits> flags) -> decltype(parse_flags_impl<Arg>(0, flags))
+		{
+			return parse_flags_impl<Arg>(0, flags);
+		}
+		
+		template<class Arg, class CharT, class Traits>
+		using parsed_flags_type = decltype(parse_flags<Arg>(declval<basic_string_view<CharT, Traits>>()));
+		
+		template<class Arg, class CharT, class Traits>
+		using has_parsed_flags = integral_constant<bool, !is_same<parsed_flags_type<Arg, CharT, Traits>, basic_string_view<CharT, Traits>>::value>;
+		
 		template<class Arg, class Appender, class FmtFlags>
-		size_t dispatch_to_string(const Arg& arg, Appender& app, FmtFlags flags)
+		size_t dispatch_to_string(const Arg& arg, Appender& app, const FmtFlags& flags)
 		{
 			return dispatch_to_string(arg, app, flags,
 									  has_overload2_opt<Arg, Appender, FmtFlags>(0),
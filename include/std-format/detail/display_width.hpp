@@ -0,0 +1,198 @@
+//
+//  display_width.hpp
+//  std-format
+//
+//  Created by knejp on 14.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_display_width_hpp
+#define std_format_detail_display_width_hpp
+
+#include <std-format/detail/brace_scanner.hpp>
+#include <std-format/detail/unicode.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STD_FORMAT_DISPLAY_WIDTH_SSE2
+#endif
+
+// Alignment pads to a width in columns, not in code units.
+// By default every code point is one column. Define STD_FORMAT_EAST_ASIAN_WIDTH to 1 to count East Asian wide and fullwidth characters as two columns
+// and combining marks and other zero width characters as none. The ranges below cover the common blocks, they are not a complete Unicode property table.
+#ifndef STD_FORMAT_EAST_ASIAN_WIDTH
+#	define STD_FORMAT_EAST_ASIAN_WIDTH 0
+#endif
+
+// Formatted fields are mostly ASCII, so for narrow strings runs of ASCII are skipped in blocks of 32 (AVX2), 16 (SSE2) or 8 (SWAR) characters at a time
+// and only the remaining characters are decoded. The encoding is determined by the size of the character type: UTF-8, UTF-16 or UTF-32.
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		/// The number of columns occupied by the characters in [first, last).
+		template<class CharT, class Iter>
+		size_t display_width(Iter first, Iter last);
+
+		/// Returns the first character in [first, last) which is not ASCII, or \p last.
+		template<class Iter>
+		Iter skip_ascii(Iter first, Iter last)
+		{
+			while(first != last && (static_cast<uint32_t>(*first) & ~uint32_t(0x7F)) == 0)
+				++first;
+			return first;
+		}
+
+		inline const char* skip_ascii(const char* first, const char* last);
+		inline char* skip_ascii(char* first, char* last) { return first + (skip_ascii(static_cast<const char*>(first), last) - first); }
+
+		struct code_point_range
+		{
+			char32_t first;
+			char32_t last;
+		};
+
+		template<size_t N>
+		bool in_code_point_ranges(char32_t cp, const code_point_range (&ranges)[N])
+		{
+			auto range = lower_bound(begin(ranges), end(ranges), cp, [](const code_point_range& r, char32_t cp) { return r.last < cp; });
+			return range != end(ranges) && range->first <= cp;
+		}
+
+		inline size_t code_point_width(char32_t cp)
+		{
+#if STD_FORMAT_EAST_ASIAN_WIDTH
+			static const code_point_range zero_width[] =
+			{
+				{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF }, { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 },
+				{ 0x0610, 0x061A }, { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 }, { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED },
+				{ 0x0900, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 },
+				{ 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E },
+				{ 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF },
+				{ 0xE0100, 0xE01EF },
+			};
+			static const code_point_range wide[] =
+			{
+				{ 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC }, { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE },
+				{ 0x2614, 0x2615 }, { 0x2648, 0x2653 }, { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+				{ 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B }, { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x2753, 0x2755 },
+				{ 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF }, { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 },
+				{ 0x2E80, 0x3029 }, { 0x302E, 0x303E }, { 0x3041, 0x3098 }, { 0x309B, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0xA4CF }, { 0xA960, 0xA97F },
+				{ 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x18CFF },
+				{ 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 },
+				{ 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF }, { 0x1F7E0, 0x1F7EB }, { 0x1F90C, 0x1F9FF }, { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD },
+				{ 0x30000, 0x3FFFD },
+			};
+			if(cp < 0x300)
+				return 1;
+			if(in_code_point_ranges(cp, zero_width))
+				return 0;
+			return in_code_point_ranges(cp, wide) ? 2 : 1;
+#else
+			static_cast<void>(cp);
+			return 1;
+#endif
+		}
+
+		// A sequence cut off by the end of the value occupies one column per character like any other malformed sequence
+		template<class Iter, size_t Size>
+		char32_t decode_or_replace(Iter& first, Iter last, integral_constant<size_t, Size> size)
+		{
+			auto cp = decode_code_point(first, last, size);
+			if(cp == incomplete_sequence)
+			{
+				++first;
+				return replacement_character;
+			}
+			return cp;
+		}
+
+		template<class Iter>
+		size_t display_width(Iter first, Iter last, integral_constant<size_t, 1> utf8)
+		{
+			size_t width = 0;
+			while(first != last)
+			{
+				auto ascii = skip_ascii(first, last);
+				width += static_cast<size_t>(distance(first, ascii));
+				first = ascii;
+				if(first != last)
+					width += code_point_width(decode_or_replace(first, last, utf8));
+			}
+			return width;
+		}
+
+		template<class Iter>
+		size_t display_width(Iter first, Iter last, integral_constant<size_t, 2> utf16)
+		{
+			size_t width = 0;
+			while(first != last)
+				width += code_point_width(decode_or_replace(first, last, utf16));
+			return width;
+		}
+
+		template<class Iter>
+		size_t display_width(Iter first, Iter last, integral_constant<size_t, 4>)
+		{
+#if STD_FORMAT_EAST_ASIAN_WIDTH
+			size_t width = 0;
+			for( ; first != last; ++first)
+				width += code_point_width(static_cast<char32_t>(*first));
+			return width;
+#else
+			return static_cast<size_t>(distance(first, last));
+#endif
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+template<class CharT, class Iter>
+size_t std::experimental::detail::display_width(Iter first, Iter last)
+{
+	return display_width(first, last, integral_constant<size_t, sizeof(CharT)>());
+}
+
+inline const char* std::experimental::detail::skip_ascii(const char* first, const char* last)
+{
+#if defined(__AVX2__)
+	for( ; last - first >= 32; first += 32)
+	{
+		auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+		auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(block));
+		if(mask != 0)
+			return first + count_trailing_zeros(mask);
+	}
+#endif
+#if defined(__AVX2__) || defined(STD_FORMAT_DISPLAY_WIDTH_SSE2)
+	for( ; last - first >= 16; first += 16)
+	{
+		auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		auto mask = static_cast<uint32_t>(_mm_movemask_epi8(block));
+		if(mask != 0)
+			return first + count_trailing_zeros(mask);
+	}
+#endif
+	// Portable fallback and the remaining tail, the exact position within a block is found by the scalar loop below
+	for( ; last - first >= 8; first += 8)
+	{
+		uint64_t block;
+		memcpy(&block, first, sizeof(block));
+		if((block & 0x8080808080808080u) != 0)
+			break;
+	}
+	while(first != last && static_cast<unsigned char>(*first) < 0x80)
+		++first;
+	return first;
+}
+
+#undef STD_FORMAT_DISPLAY_WIDTH_SSE2
+
+#endif // std_format_detail_display_width_hpp
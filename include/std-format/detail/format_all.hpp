@@ -0,0 +1,303 @@
+//
+//  format_all.hpp
+//  std-format
+//
+//  Created by knejp on 12.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_all_hpp
+#define std_format_detail_format_all_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		template<class FormatSource, class Tuple, size_t... I>
+		auto make_bulk_formatter(const FormatSource& fmt, index_sequence<I...>)
+			-> formatter<basic_string_view<char_type<FormatSource>, traits_type<FormatSource>>, typename tuple_element<I, Tuple>::type...>
+		{
+			return formatter<basic_string_view<char_type<FormatSource>, traits_type<FormatSource>>, typename tuple_element<I, Tuple>::type...>{ fmt };
+		}
+
+		// Format strings are parsed once up front, format literals and formatters are used as they are
+		template<class Tuple, class FormatSource>
+		auto bulk_format_source(const FormatSource& fmt, true_type /*parse*/)
+			-> decltype(make_bulk_formatter<FormatSource, Tuple>(fmt, make_index_sequence<tuple_size<Tuple>::value>()))
+		{
+			return make_bulk_formatter<FormatSource, Tuple>(fmt, make_index_sequence<tuple_size<Tuple>::value>());
+		}
+		template<class Tuple, class FormatSource>
+		const FormatSource& bulk_format_source(const FormatSource& fmt, false_type /*parse*/)
+		{
+			return fmt;
+		}
+
+		template<class FormatSource>
+		using needs_parsing = integral_constant<bool, !is_empty<FormatSource>::value
+			&& is_convertible<FormatSource, basic_string_view<char_type<FormatSource>, traits_type<FormatSource>>>::value>;
+
+		/// Worker threads shared by all format_all() calls.
+		/// Threads are started on demand, when a call asks for more helpers than there are threads, and kept until the program ends.
+		class format_worker_pool
+		{
+		public:
+			static format_worker_pool& instance()
+			{
+				static format_worker_pool pool;
+				return pool;
+			}
+
+			~format_worker_pool();
+
+			/// Queue \p task to be run by \p n workers, starting threads up to a total of \p n if necessary.
+			/// If a thread cannot be started the task runs on fewer workers.
+			void submit(size_t n, const function<void()>& task);
+
+		private:
+			format_worker_pool() = default;
+			void run();
+
+			mutex _mutex;
+			condition_variable _wake;
+			deque<function<void()>> _tasks;
+			vector<thread> _threads;
+			bool _stop = false;
+		};
+
+		/// Tracks the helpers of one format_all() call.
+		/// A helper only starts working while the job is open, the caller closes it when done and waits for the helpers inside.
+		class format_job
+		{
+		public:
+			bool enter()
+			{
+				lock_guard<mutex> lock(_mutex);
+				if(_closed)
+					return false;
+				++_running;
+				return true;
+			}
+
+			void leave()
+			{
+				lock_guard<mutex> lock(_mutex);
+				if(--_running == 0)
+					_done.notify_all();
+			}
+
+			void close_and_wait()
+			{
+				unique_lock<mutex> lock(_mutex);
+				_closed = true;
+				_done.wait(lock, [this] { return _running == 0; });
+			}
+
+		private:
+			mutex _mutex;
+			condition_variable _done;
+			size_t _running = 0;
+			bool _closed = false;
+		};
+
+		// Closes the job even if queuing the helpers throws, the helpers refer to the caller's stack
+		struct format_job_guard
+		{
+			format_job& job;
+			~format_job_guard() { job.close_and_wait(); }
+		};
+
+		template<class Appender, class Program, class Tuple, size_t... I>
+		void format_tuple(Appender& app, const Program& program, const Tuple& args, index_sequence<I...>)
+		{
+			format(in_place, app, program, get<I>(args)...);
+		}
+
+		/// Format the records in [first, last) in chunks of \p opts.chunk_size on up to \p opts.threads threads.
+		/// Returns the output of every chunk in order.
+		template<class String, class Program, class Iter>
+		vector<String> format_chunks(const Program& program, Iter first, Iter last, format_all_options opts)
+		{
+			using Tuple = typename iterator_traits<Iter>::value_type;
+
+			auto count = static_cast<size_t>(distance(first, last));
+			auto chunk_size = max(opts.chunk_size, size_t(1));
+			auto chunks = (count + chunk_size - 1) / chunk_size;
+			auto threads = opts.threads > 0 ? opts.threads : max(thread::hardware_concurrency(), 1u);
+			threads = min(threads, chunks);
+
+			vector<String> output(chunks);
+			atomic<size_t> next{0};
+			atomic<bool> failed{false};
+
+			// Find the start of every chunk in one pass in case the iterators are not random access
+			vector<Iter> starts;
+			starts.reserve(chunks);
+			for(size_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				starts.push_back(first);
+				advance(first, min(chunk_size, count - chunk * chunk_size));
+			}
+
+			// Every thread takes the next unformatted chunk until all are done, thus the order of the output does not depend on scheduling
+			auto take_chunks = [&]
+			{
+				for(auto chunk = next++; chunk < chunks && !failed; chunk = next++)
+				{
+					auto iter = starts[chunk];
+					auto n = min(chunk_size, count - chunk * chunk_size);
+					auto app = make_format_appender(output[chunk]);
+					for(size_t i = 0; i < n; ++i, ++iter)
+						format_tuple(app, program, *iter, make_index_sequence<tuple_size<Tuple>::value>());
+				}
+			};
+#if STD_FORMAT_EXCEPTIONS
+			exception_ptr error;
+			auto work = [&]
+			{
+				try
+				{
+					take_chunks();
+				}
+				catch(...)
+				{
+					// Keep the first error, the others are most likely the same
+					if(!failed.exchange(true))
+						error = current_exception();
+				}
+			};
+#else
+			auto& work = take_chunks;
+#endif
+
+			// The calling thread formats chunks as well, the pool only lends helpers.
+			// On the way out the job is closed and only the helpers which already started are waited for,
+			// so a call never waits for workers busy with other jobs and nested calls cannot deadlock.
+			auto job = make_shared<format_job>();
+			{
+				format_job_guard guard{ *job };
+				if(threads > 1)
+				{
+					format_worker_pool::instance().submit(threads - 1, [job, &work]
+					{
+						if(job->enter())
+						{
+							work();
+							job->leave();
+						}
+					});
+				}
+				work();
+			}
+#if STD_FORMAT_EXCEPTIONS
+			if(error)
+				rethrow_exception(error);
+#endif
+			return output;
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+inline std::experimental::detail::format_worker_pool::~format_worker_pool()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for(auto& t : _threads)
+		t.join();
+}
+
+inline void std::experimental::detail::format_worker_pool::submit(size_t n, const function<void()>& task)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		while(_threads.size() < n)
+		{
+#if STD_FORMAT_EXCEPTIONS
+			try
+			{
+				_threads.emplace_back([this] { run(); });
+			}
+			catch(const system_error&)
+			{
+				break;
+			}
+#else
+			_threads.emplace_back([this] { run(); });
+#endif
+		}
+		for(size_t i = 0; i < n; ++i)
+			_tasks.push_back(task);
+	}
+	_wake.notify_all();
+}
+
+inline void std::experimental::detail::format_worker_pool::run()
+{
+	unique_lock<mutex> lock(_mutex);
+	while(true)
+	{
+		_wake.wait(lock, [this] { return _stop || !_tasks.empty(); });
+		// Tasks still queued at exit belong to jobs which are closed already
+		if(_stop)
+			return;
+		auto task = move(_tasks.front());
+		_tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+template<class FormatSource, class Iter>
+auto std::experimental::format_all(const FormatSource& fmt, Iter first, Iter last, format_all_options opts)
+	-> detail::string_type<FormatSource, detail::allocator_type<FormatSource>>
+{
+	using String = detail::string_type<FormatSource, detail::allocator_type<FormatSource>>;
+	using Tuple = typename iterator_traits<Iter>::value_type;
+
+	// The worker threads have no error scope of their own, so errors are thrown on every thread alike
+	detail::format_throw_scope scope;
+	const auto& program = detail::bulk_format_source<Tuple>(fmt, detail::needs_parsing<FormatSource>());
+	auto chunks = detail::format_chunks<String>(program, first, last, opts);
+	size_t size = 0;
+	for(const auto& chunk : chunks)
+		size += chunk.size();
+	String result;
+	result.reserve(size);
+	for(const auto& chunk : chunks)
+		result.append(chunk);
+	return result;
+}
+
+template<class Destination, class FormatSource, class Iter>
+size_t std::experimental::format_all(in_place_t, Destination& dest, const FormatSource& fmt, Iter first, Iter last, format_all_options opts)
+{
+	using String = detail::string_type<FormatSource, detail::allocator_type<FormatSource>>;
+	using Tuple = typename iterator_traits<Iter>::value_type;
+
+	detail::format_throw_scope scope;
+	const auto& program = detail::bulk_format_source<Tuple>(fmt, detail::needs_parsing<FormatSource>());
+	auto chunks = detail::format_chunks<String>(program, first, last, opts);
+	auto&& app = make_format_appender(dest);
+	size_t size = 0;
+	for(const auto& chunk : chunks)
+	{
+		app.append(chunk.data(), chunk.size());
+		size += chunk.size();
+	}
+	return size;
+}
+
+#endif // std_format_detail_format_all_hpp
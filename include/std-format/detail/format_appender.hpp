@@ -9,10 +9,15 @@
 #ifndef std_format_detail_format_appender_hpp
 #define std_format_detail_format_appender_hpp
 
+#include <std-format/detail/format_error.hpp>
 #include <std-format/detail/string_view.hpp>
+#include <std-format/detail/unicode.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <std-format/type_traits.hpp>
@@ -26,13 +31,24 @@ namespace std { namespace experimental
 	 - Enable block-writing operations for types which support it and where it may be more efficient than writing every single character separate.
 	 - Serve as tag type to disambiguate conflicting to_string() overloads.
 	 
-	 Every specialization of \p appender has the following four methods:
+	 Every specialization of \p appender has the following five methods:
 	 - `appender& append(CharT ch)`: appends a single character to the underlying sink.
 	 - `appender& append(const CharT* str, size_t len)`: appends an array of characters to the sink, possibly performing a block-operation that may be more efficient than a looped per-character append.
+	 - `appender& append(size_t n, CharT ch)`: appends \p n copies of \p ch, used for padding. Like the array overload this may be performed as a block-operation.
 	 - `appender& append(basic_string_view<...> str)`: Convenience overload, same as for arrays but takes it's data from a \p basic_string_view.
 	 - `appender& append(const basic_string<...>& str)`: Convenience overload, same as for arrays but takes it's data from a \p basic_string.
 
 	 Every append method returns a reference to itself to allow chaining or convenient returning from a function.
+	 Appenders for sinks with random access to what was already written (strings and random access ranges) additionally provide
+	 `appender& pad_tail(size_t len, size_t count, CharT ch)` which moves the last \p len characters \p count positions to the right and fills the gap with \p ch,
+	 and `tail(size_t len)` which returns an iterator to the first of the last \p len characters.
+	 This allows measuring and right-aligning a value after it was written directly to the sink.
+	 Appenders which can expose their storage (strings, contiguous ranges, the put area of streambufs, containers behind a \p back_insert_iterator and small buffers) additionally provide
+	 `CharT* prepare(size_t n)` which returns a window of at least \p n writable characters at the end of the sink, or \p nullptr if none is available,
+	 and `appender& commit(size_t used)` which appends the first \p used characters of the window.
+	 Every successful \p prepare() must be followed by \p commit() before anything else is appended.
+	 This allows writing characters directly to their final destination without an intermediate buffer.
+	 Appenders for sinks with an allocator (strings and small buffers) provide `get_allocator()`, which is used for all temporaries needed while formatting to them.
 	 The *exact* type of \p CharT is not defined and depends on \p Sink, however it should be one of the builtin character types.
 	 
 	 Various specializations of \p appender are predefined to be usable with as many existing types as possible (\p sink is a placeholder for the actual instance of the \p sink type):
@@ -42,13 +58,22 @@ namespace std { namespace experimental
 	 - If \p Sink is a \p ostream_iterator then behavior is the same as for an ordinary \p OutputIterator except that if \p ostream_iterator::failed() signals \p true then \p append() throws.
 	 - If \p Sink is implicitly convertible to \p basic_streambuf then streambuf::sputn() and streambuf::sputc() are used for appending, throwing if they signal _EOF_ conditions.
 	 - If \p Sink is implicitly convertible to \p basic_ostream then appending writes to `*basic_ostream::rdbuf()` and behaves the same as above.
+	 - If \p Sink is a \p transcoding_sink the characters are converted to the encoding of the sink it wraps and appended to that.
 	 - If none of the above apply the user is required to specialize the \p appender class for the given \p Sink type.
+	 While errors are collected by the non-throwing format() overloads the appenders report them instead of throwing and write only what fits.
 	 
 	 It is encouraged to use make_format_appender() for creating appenders to save oneself the hassle of specifying template parameters.
 	 */
 	template<class Sink>
 	class format_appender;
 	
+	template<class CharT, class Sink>
+	class transcoding_sink;
+	
+	/// Wrap \p sink to accept characters of type \p CharT, e.g. `make_transcoding_sink<char16_t>(utf8_string)`.
+	template<class CharT, class Sink>
+	transcoding_sink<CharT, Sink> make_transcoding_sink(Sink& sink) { return transcoding_sink<CharT, Sink>{ sink }; }
+	
 	namespace detail
 	{
 		class write_counter
@@ -61,6 +86,38 @@ namespace std { namespace experimental
 			size_t _count = 0;
 		};
 		
+		/// Access to the container behind a back_insert_iterator.
+		template<class Container>
+		struct back_insert_access : back_insert_iterator<Container>
+		{
+			static Container* get(back_insert_iterator<Container>& iter) { return iter.*&back_insert_access::container; }
+		};
+		
+		/// The container behind \p iter if its storage is contiguous and can be resized.
+		template<class Container>
+		auto contiguous_container(back_insert_iterator<Container>& iter)
+			-> decltype(declval<Container&>().data(), declval<Container&>()[0], declval<Container&>().resize(0), static_cast<Container*>(nullptr))
+		{
+			return back_insert_access<Container>::get(iter);
+		}
+		
+		/// Access to the protected put area of a streambuf.
+		template<class CharT, class Traits>
+		struct put_area : basic_streambuf<CharT, Traits>
+		{
+			using streambuf_type = basic_streambuf<CharT, Traits>;
+			
+			static CharT* next(streambuf_type& buf) { return (buf.*&put_area::pptr)(); }
+			static size_t available(streambuf_type& buf) { return static_cast<size_t>((buf.*&put_area::epptr)() - next(buf)); }
+			static void bump(streambuf_type& buf, size_t n)
+			{
+				constexpr auto max_bump = static_cast<size_t>(numeric_limits<int>::max());
+				for( ; n > max_bump; n -= max_bump)
+					(buf.*&put_area::pbump)(numeric_limits<int>::max());
+				(buf.*&put_area::pbump)(static_cast<int>(n));
+			}
+		};
+		
 		template<class Derived, class OutIter>
 		class iterator_appender
 		{
@@ -87,17 +144,44 @@ namespace std { namespace experimental
 				return static_cast<Derived&>(*this);
 			}
 			
+			template<class CharT>
+			Derived& append(size_t n, CharT ch)
+			{
+				_iter = fill_n(_iter, n, ch);
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
+			
 			template<class CharT, class Traits>
 			Derived& append(basic_string_view<CharT, Traits> str) { return append(str.data(), str.size()); }
 			template<class CharT, class Traits, class Allocator>
 			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
 			
+			/// Only available for back_insert_iterator of containers with contiguous storage.
+			template<class Iter = OutIter>
+			auto prepare(size_t n) -> decltype(&(*contiguous_container(declval<Iter&>()))[0])
+			{
+				auto c = contiguous_container(_iter);
+				_prepared = c->size();
+				c->resize(_prepared + n);
+				return &(*c)[_prepared];
+			}
+			
+			template<class Iter = OutIter>
+			auto commit(size_t used) -> decltype(contiguous_container(declval<Iter&>()), declval<Derived&>())
+			{
+				contiguous_container(_iter)->resize(_prepared + used);
+				static_cast<Derived&>(*this).increment_write_counter(used);
+				return static_cast<Derived&>(*this);
+			}
+			
 		protected:
 			iterator_appender(iterator_appender&&) = default;
 			iterator_appender& operator= (iterator_appender&&) = default;
 			
 		private:
 			OutIter _iter;
+			size_t _prepared = 0; // Size of the container before prepare()
 		};
 		
 		template<class Derived, class Container>
@@ -113,7 +197,10 @@ namespace std { namespace experimental
 			Derived& append(value_type ch)
 			{
 				if(_first == _last)
-					throw runtime_error{"buffer overflow in format_appender"};
+				{
+					overflow();
+					return static_cast<Derived&>(*this);
+				}
 				*_first++ = move(ch);
 				static_cast<Derived&>(*this).increment_write_counter(1);
 				return static_cast<Derived&>(*this);
@@ -122,8 +209,15 @@ namespace std { namespace experimental
 			Derived& append(const value_type* str, size_t len)
 			{
 				assert(str && "NULL buffer passed to append()");
-				append_block(str, len, typename iterator_traits<Iter>::iterator_category());
-				static_cast<Derived&>(*this).increment_write_counter(len);
+				auto written = append_block(str, len, typename iterator_traits<Iter>::iterator_category());
+				static_cast<Derived&>(*this).increment_write_counter(written);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(size_t n, value_type ch)
+			{
+				auto written = fill_block(n, ch, typename iterator_traits<Iter>::iterator_category());
+				static_cast<Derived&>(*this).increment_write_counter(written);
 				return static_cast<Derived&>(*this);
 			}
 			template<class CharT, class Traits>
@@ -131,25 +225,91 @@ namespace std { namespace experimental
 			template<class CharT, class Traits, class Allocator>
 			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
 
+			/// Shift the last \p len characters written by \p count positions to the right and fill the gap with \p ch.
+			template<class Category = typename iterator_traits<Iter>::iterator_category>
+			auto pad_tail(size_t len, size_t count, value_type ch)
+				-> typename enable_if<is_convertible<Category, random_access_iterator_tag>::value, Derived&>::type
+			{
+				if(static_cast<size_t>(distance(_first, _last)) < count)
+				{
+					overflow();
+					return static_cast<Derived&>(*this);
+				}
+				auto first = _first - len;
+				move_backward(first, _first, _first + count);
+				fill_n(first, count, ch);
+				_first += count;
+				static_cast<Derived&>(*this).increment_write_counter(count);
+				return static_cast<Derived&>(*this);
+			}
+
+			/// The position of the last \p len characters written.
+			template<class Category = typename iterator_traits<Iter>::iterator_category>
+			auto tail(size_t len) const
+				-> typename enable_if<is_convertible<Category, random_access_iterator_tag>::value, Iter>::type
+			{
+				return _first - len;
+			}
+			
+			/// Only available if the storage is contiguous, which is assumed if \p Container has a \p data() member.
+			template<class C = Container>
+			auto prepare(size_t n) -> decltype(declval<C&>().data(), static_cast<value_type*>(nullptr))
+			{
+				if(static_cast<size_t>(distance(_first, _last)) < n)
+					return nullptr;
+				return &*_first;
+			}
+			
+			template<class C = Container>
+			auto commit(size_t used) -> decltype(declval<C&>().data(), declval<Derived&>())
+			{
+				_first += used;
+				static_cast<Derived&>(*this).increment_write_counter(used);
+				return static_cast<Derived&>(*this);
+			}
+
 		protected:
 			range_checked_appender(range_checked_appender&&) = default;
 			range_checked_appender& operator= (range_checked_appender&&) = default;
 			
 		private:
-			void append_block(const value_type* str, size_t len, random_access_iterator_tag)
+			// If errors are collected instead of thrown the output is truncated to what fits into the range.
+			// The block writers return the number of characters actually written so the write counter never exceeds the output.
+			static void overflow() { raise_format_error(format_errc::buffer_overflow, "buffer overflow in format_appender"); }
+			
+			size_t append_block(const value_type* str, size_t len, random_access_iterator_tag)
 			{
-				if(distance(_first, _last) < len)
-					throw runtime_error{"buffer overflow in format_appender"};
-				static_cast<Derived&>(*this).increment_write_counter(1);
-				_first = copy_n(str, len, _first);
+				auto n = min(len, static_cast<size_t>(distance(_first, _last)));
+				_first = copy_n(str, n, _first);
+				if(n < len)
+					overflow();
+				return n;
 			}
-			void append_block(const value_type* str, size_t len, ...)
+			size_t fill_block(size_t n, value_type ch, random_access_iterator_tag)
+			{
+				auto count = min(n, static_cast<size_t>(distance(_first, _last)));
+				_first = fill_n(_first, count, ch);
+				if(count < n)
+					overflow();
+				return count;
+			}
+			size_t fill_block(size_t n, value_type ch, ...)
+			{
+				size_t i = 0;
+				for( ; i < n && _first != _last; ++i)
+					*_first++ = ch;
+				if(i < n)
+					overflow();
+				return i;
+			}
+			size_t append_block(const value_type* str, size_t len, ...)
 			{
 				size_t i = 0;
 				for(auto s_iter = str; i < len && _first != _last; ++i)
 					*_first++ = *s_iter++;
 				if(i < len)
-					throw runtime_error{"buffer overflow in format_appender"};
+					overflow();
+				return i;
 			}
 			
 			Iter _first;
@@ -168,7 +328,7 @@ namespace std { namespace experimental
 			{
 				*_iter++ = std::move(ch);
 				if(_iter.failed())
-					throw runtime_error{"buffer overflow in format_appender"};
+					raise_format_error(format_errc::write_failed, "buffer overflow in format_appender");
 				static_cast<Derived&>(*this).increment_write_counter(1);
 				return static_cast<Derived&>(*this);
 			}
@@ -178,10 +338,19 @@ namespace std { namespace experimental
 				assert(str && "NULL buffer passed to append()");
 				_iter = copy_n(str, len, _iter);
 				if(_iter.failed())
-					throw runtime_error{"buffer overflow in format_appender"};
+					raise_format_error(format_errc::write_failed, "buffer overflow in format_appender");
 				static_cast<Derived&>(*this).increment_write_counter(len);
 				return static_cast<Derived&>(*this);
 			}
+			
+			Derived& append(size_t n, value_type ch)
+			{
+				_iter = fill_n(_iter, n, ch);
+				if(_iter.failed())
+					raise_format_error(format_errc::write_failed, "buffer overflow in format_appender");
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
 			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
 			template<class Allocator>
 			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
@@ -206,28 +375,78 @@ namespace std { namespace experimental
 			Derived& append(CharT ch)
 			{
 				if(Traits::eq_int_type(_buf->sputc(ch), Traits::eof()))
-					throw runtime_error{"Error writing to ostreambuf."};
-				static_cast<Derived&>(*this).increment_write_counter(1);
+					raise_format_error(format_errc::write_failed, "Error writing to ostreambuf.");
+				else
+					static_cast<Derived&>(*this).increment_write_counter(1);
 				return static_cast<Derived&>(*this);
 			}
 			
 			Derived& append(const value_type* str, size_t len)
 			{
 				assert(str && "NULL buffer passed to append()");
-				if(_buf->sputn(str, len) != len)
-					throw runtime_error{"buffer overflow in format_appender"};
-				static_cast<Derived&>(*this).increment_write_counter(len);
+				// Copy to the put area directly if it has room to skip the virtual xsputn()
+				if(auto out = prepare(len))
+				{
+					Traits::copy(out, str, len);
+					return commit(len);
+				}
+				auto written = written_count(_buf->sputn(str, len));
+				if(written != len)
+					raise_format_error(format_errc::write_failed, "buffer overflow in format_appender");
+				static_cast<Derived&>(*this).increment_write_counter(written);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(size_t n, CharT ch)
+			{
+				if(auto out = prepare(n))
+				{
+					Traits::assign(out, n, ch);
+					return commit(n);
+				}
+				// Write the fill in blocks instead of one virtual sputc() per character
+				CharT block[64];
+				Traits::assign(block, min(n, sizeof(block) / sizeof(CharT)), ch);
+				size_t written = 0;
+				while(written < n)
+				{
+					auto count = min(n - written, sizeof(block) / sizeof(CharT));
+					auto block_written = written_count(_buf->sputn(block, count));
+					written += block_written;
+					if(block_written != count)
+					{
+						raise_format_error(format_errc::write_failed, "buffer overflow in format_appender");
+						break;
+					}
+				}
+				static_cast<Derived&>(*this).increment_write_counter(written);
 				return static_cast<Derived&>(*this);
 			}
 			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
 			template<class Allocator>
 			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
+			
+			/// The window is the free space of the put area, therefore this returns \p nullptr if the streambuf is unbuffered or the put area is too small.
+			CharT* prepare(size_t n)
+			{
+				return put_area<CharT, Traits>::available(*_buf) < n ? nullptr : put_area<CharT, Traits>::next(*_buf);
+			}
+			
+			Derived& commit(size_t used)
+			{
+				put_area<CharT, Traits>::bump(*_buf, used);
+				static_cast<Derived&>(*this).increment_write_counter(used);
+				return static_cast<Derived&>(*this);
+			}
 
 		protected:
 			streambuf_appender(streambuf_appender&&) = default;
 			streambuf_appender& operator= (streambuf_appender&&) = default;
 			
 		private:
+			// sputn() reports the characters it wrote, a failing streambuf may even return a negative count
+			static size_t written_count(streamsize n) { return n > 0 ? static_cast<size_t>(n) : 0; }
+
 			basic_streambuf<CharT, Traits>* _buf;
 		};
 		
@@ -253,18 +472,328 @@ namespace std { namespace experimental
 				static_cast<Derived&>(*this).increment_write_counter(len);
 				return static_cast<Derived&>(*this);
 			}
+			
+			Derived& append(size_t n, CharT ch)
+			{
+				_str->append(n, ch);
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
 			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
 			template<class Allocator2>
 			Derived& append(const basic_string<CharT, Traits, Allocator2>& str) { return append(str.data(), str.size()); }
 			
+			/// Shift the last \p len characters written by \p count positions to the right and fill the gap with \p ch.
+			Derived& pad_tail(size_t len, size_t count, CharT ch)
+			{
+				_str->append(count, ch);
+				auto first = &(*_str)[_str->size() - count - len];
+				Traits::move(first + count, first, len);
+				Traits::assign(first, count, ch);
+				static_cast<Derived&>(*this).increment_write_counter(count);
+				return static_cast<Derived&>(*this);
+			}
+
+			/// The position of the last \p len characters written.
+			const CharT* tail(size_t len) const { return _str->data() + _str->size() - len; }
+			
+			/// The window is limited to the reserved capacity so that a string sized in advance by format(exact_size, ...) never grows.
+			CharT* prepare(size_t n)
+			{
+				if(_str->capacity() - _str->size() < n)
+					return nullptr;
+				_prepared = _str->size();
+				_str->resize(_prepared + n);
+				return &(*_str)[_prepared];
+			}
+			
+			Derived& commit(size_t used)
+			{
+				_str->resize(_prepared + used);
+				static_cast<Derived&>(*this).increment_write_counter(used);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Allocator get_allocator() const { return _str->get_allocator(); }
+			
 		protected:
 			string_appender(string_appender&&) = default;
 			string_appender& operator= (string_appender&&) = default;
 			
 		private:
 			basic_string<CharT, Traits, Allocator>* _str;
+			size_t _prepared = 0; // Size of the string before prepare()
 		};
 
+		/// A sink that discards all characters.
+		/// Appending to it only updates the write count, which is used to determine the output size in advance.
+		template<class CharT>
+		struct counting_sink { };
+		
+		template<class Derived, class CharT>
+		class counting_appender
+		{
+		public:
+			using value_type = CharT;
+			
+			counting_appender(counting_sink<CharT>&) { }
+			
+			Derived& append(CharT)
+			{
+				static_cast<Derived&>(*this).increment_write_counter(1);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(const value_type*, size_t len)
+			{
+				static_cast<Derived&>(*this).increment_write_counter(len);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(size_t n, CharT)
+			{
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
+			template<class Traits>
+			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
+			template<class Traits, class Allocator>
+			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
+			
+		protected:
+			counting_appender(counting_appender&&) = default;
+			counting_appender& operator= (counting_appender&&) = default;
+		};
+		
+		/// A growable character buffer with inline storage for the first \p N characters.
+		/// Used for temporaries which are discarded right after formatting, thus most of the time no memory is allocated at all.
+		/// Longer contents spill to memory obtained from \p Allocator.
+		template<class CharT, size_t N = 256, class Allocator = allocator<CharT>>
+		class small_buffer
+		{
+		public:
+			using allocator_type = Allocator;
+			
+			small_buffer() = default;
+			explicit small_buffer(const Allocator& alloc) : _alloc(alloc) { }
+			small_buffer(const small_buffer&) = delete;
+			small_buffer& operator= (const small_buffer&) = delete;
+			~small_buffer() { release(); }
+			
+			const CharT* data() const { return _data; }
+			size_t size() const { return _size; }
+			allocator_type get_allocator() const { return _alloc; }
+			
+			void append(CharT ch)
+			{
+				if(_size == _capacity)
+					grow(1);
+				_data[_size++] = ch;
+			}
+			void append(const CharT* str, size_t len)
+			{
+				if(len > _capacity - _size)
+					grow(len);
+				copy_n(str, len, _data + _size);
+				_size += len;
+			}
+			void append(size_t n, CharT ch)
+			{
+				if(n > _capacity - _size)
+					grow(n);
+				fill_n(_data + _size, n, ch);
+				_size += n;
+			}
+			CharT* prepare(size_t n)
+			{
+				if(n > _capacity - _size)
+					grow(n);
+				return _data + _size;
+			}
+			void commit(size_t used) { _size += used; }
+			
+		private:
+			using alloc_traits = allocator_traits<Allocator>;
+			
+			void grow(size_t n)
+			{
+				auto capacity = max(_capacity * 2, _size + n);
+				auto heap = alloc_traits::allocate(_alloc, capacity);
+				copy_n(_data, _size, heap);
+				release();
+				_data = heap;
+				_capacity = capacity;
+			}
+			void release()
+			{
+				if(_data != _local)
+					alloc_traits::deallocate(_alloc, _data, _capacity);
+			}
+			
+			CharT _local[N];
+			CharT* _data = _local;
+			size_t _size = 0;
+			size_t _capacity = N;
+			Allocator _alloc;
+		};
+		
+		template<class Derived, class CharT, size_t N, class Allocator>
+		class small_buffer_appender
+		{
+		public:
+			using value_type = CharT;
+			
+			small_buffer_appender(small_buffer<CharT, N, Allocator>& buf) : _buf(&buf) { }
+			
+			Derived& append(CharT ch)
+			{
+				_buf->append(ch);
+				static_cast<Derived&>(*this).increment_write_counter(1);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(const value_type* str, size_t len)
+			{
+				assert(str && "NULL buffer passed to append()");
+				_buf->append(str, len);
+				static_cast<Derived&>(*this).increment_write_counter(len);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(size_t n, CharT ch)
+			{
+				_buf->append(n, ch);
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
+			template<class Traits>
+			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
+			template<class Traits, class Allocator2>
+			Derived& append(const basic_string<CharT, Traits, Allocator2>& str) { return append(str.data(), str.size()); }
+			
+			CharT* prepare(size_t n) { return _buf->prepare(n); }
+			
+			Derived& commit(size_t used)
+			{
+				_buf->commit(used);
+				static_cast<Derived&>(*this).increment_write_counter(used);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Allocator get_allocator() const { return _buf->get_allocator(); }
+			
+		protected:
+			small_buffer_appender(small_buffer_appender&&) = default;
+			small_buffer_appender& operator= (small_buffer_appender&&) = default;
+			
+		private:
+			small_buffer<CharT, N, Allocator>* _buf;
+		};
+		
+		/// Converts the characters appended to it from the encoding of \p CharT to the encoding of the character type of \p Sink.
+		/// Every fragment is converted in chunks through a buffer on the stack, so no temporary string of either type is needed.
+		template<class Derived, class CharT, class Sink>
+		class transcoding_appender
+		{
+		public:
+			using value_type = CharT;
+			
+			transcoding_appender(transcoding_sink<CharT, Sink>& sink) : _sink(&sink), _out(sink.base()) { }
+			
+			Derived& append(CharT ch) { return append(&ch, 1); }
+			
+			Derived& append(const value_type* str, size_t len)
+			{
+				assert(str && "NULL buffer passed to append()");
+				transcode(str, str + len);
+				static_cast<Derived&>(*this).increment_write_counter(len);
+				return static_cast<Derived&>(*this);
+			}
+			
+			Derived& append(size_t n, CharT ch)
+			{
+				// Padding is usually ASCII and passed on as it is
+				if((static_cast<uint32_t>(ch) & ~uint32_t(0x7F)) == 0 && _sink->_pending_size == 0)
+					_out.append(n, static_cast<output_type>(ch));
+				else
+				{
+					for(size_t i = 0; i < n; ++i)
+						transcode(&ch, &ch + 1);
+				}
+				static_cast<Derived&>(*this).increment_write_counter(n);
+				return static_cast<Derived&>(*this);
+			}
+			template<class Traits>
+			Derived& append(const basic_string_view<CharT, Traits>& str) { return append(str.data(), str.size()); }
+			template<class Traits, class Allocator>
+			Derived& append(const basic_string<CharT, Traits, Allocator>& str) { return append(str.data(), str.size()); }
+			
+		protected:
+			transcoding_appender(transcoding_appender&&) = default;
+			transcoding_appender& operator= (transcoding_appender&&) = default;
+			
+		private:
+			using output_type = typename format_appender<Sink>::value_type;
+			static constexpr size_t max_length = max_transcoded_length<CharT, output_type>();
+			
+			void transcode(const CharT* first, const CharT* last)
+			{
+				// A sequence split between two fragments is completed with the first characters of this one
+				while(_sink->_pending_size > 0 && first != last)
+				{
+					CharT seq[7];
+					auto pending = _sink->_pending_size;
+					auto taken = min(static_cast<size_t>(last - first), size_t(4));
+					copy_n(_sink->_pending, pending, seq);
+					copy_n(first, taken, seq + pending);
+					output_type buf[7 * max_length];
+					auto out = buf;
+					auto consumed = static_cast<size_t>(detail::transcode(seq, seq + pending + taken, out) - seq);
+					if(out != buf)
+						_out.append(buf, out - buf);
+					if(consumed == 0)
+					{
+						// Still incomplete, thus everything fits into the pending characters
+						copy_n(seq, pending + taken, _sink->_pending);
+						_sink->_pending_size = pending + taken;
+						return;
+					}
+					if(consumed >= pending)
+					{
+						first += consumed - pending;
+						_sink->_pending_size = 0;
+					}
+					else
+					{
+						copy(_sink->_pending + consumed, _sink->_pending + pending, _sink->_pending);
+						_sink->_pending_size = pending - consumed;
+					}
+				}
+				
+				output_type buf[256];
+				constexpr auto chunk = sizeof(buf) / sizeof(buf[0]) / max_length;
+				while(first != last)
+				{
+					auto out = buf;
+					auto stop = detail::transcode(first, first + min(static_cast<size_t>(last - first), chunk), out);
+					if(out != buf)
+						_out.append(buf, out - buf);
+					if(stop == first)
+					{
+						// The fragment ends in the middle of a sequence, keep it for the next one
+						assert(last - first < 4);
+						copy(first, last, _sink->_pending);
+						_sink->_pending_size = static_cast<size_t>(last - first);
+						return;
+					}
+					first = stop;
+				}
+			}
+			
+			transcoding_sink<CharT, Sink>* _sink;
+			format_appender<Sink> _out;
+		};
+		
 		using std::begin;
 		using std::end;
 		
@@ -275,29 +804,115 @@ namespace std { namespace experimental
 		auto select_appender(OutIter it) -> decltype(select_appender<Derived>(it, typename iterator_traits<OutIter>::iterator_category()));
 		// Destinations with begin() and end() are range checked to prevent overflow
 		template<class Derived, class Container>
-		auto select_appender(Container c, decltype(begin(c))* = 0, decltype(end(c))* = 0) -> range_checked_appender<Derived, Container>;
+		auto select_appender(Container& c, decltype(begin(c))* = 0, decltype(end(c))* = 0) -> range_checked_appender<Derived, Container>;
 		// Special treatment for ostreambuf_iterator because we can check for errors
 		template<class Derived, class CharT, class Traits>
 		auto select_appender(ostreambuf_iterator<CharT, Traits> buf) -> ostreambuf_iterator_appender<Derived, CharT, Traits>;
 		// If it is derived from streambuf use the streambuf base class
 		template<class Derived, class CharT, class Traits>
-		auto select_appender(basic_streambuf<CharT, Traits> buf) -> streambuf_appender<Derived, CharT, Traits>;
+		auto select_appender(basic_streambuf<CharT, Traits>& buf) -> streambuf_appender<Derived, CharT, Traits>;
 		// If it is derived from ostream use the readbuffer
 		template<class Derived, class CharT, class Traits>
-		auto select_appender(basic_ostream<CharT, Traits> buf) -> streambuf_appender<Derived, CharT, Traits>;
+		auto select_appender(basic_ostream<CharT, Traits>& buf) -> streambuf_appender<Derived, CharT, Traits>;
 		// strings are special as they can be appended to
 		template<class Derived, class CharT, class Traits, class Allocator>
 		auto select_appender(basic_string<CharT, Traits, Allocator> s) -> string_appender<Derived, CharT, Traits, Allocator>;
+		// Temporaries on the stack
+		template<class Derived, class CharT, size_t N, class Allocator>
+		auto select_appender(small_buffer<CharT, N, Allocator>& buf) -> small_buffer_appender<Derived, CharT, N, Allocator>;
+		// Only count the characters
+		template<class Derived, class CharT>
+		auto select_appender(counting_sink<CharT>& s) -> counting_appender<Derived, CharT>;
+		// Convert to the encoding of the wrapped sink
+		template<class Derived, class CharT, class Sink>
+		auto select_appender(transcoding_sink<CharT, Sink>& s) -> transcoding_appender<Derived, CharT, Sink>;
 
 		// Cannot append to the requested type
 		template<class Derived, class T>
 		void select_appender();
+		
+		// Whether the appender provides prepare() and commit()
+		template<class Appender>
+		auto can_prepare(int) -> decltype(declval<Appender&>().prepare(size_t()), true_type());
+		template<class Appender>
+		false_type can_prepare(long);
+		
+		template<class CharT, class Appender>
+		CharT* try_prepare(Appender& app, size_t n, true_type) { return app.prepare(n); }
+		template<class CharT, class Appender>
+		CharT* try_prepare(Appender&, size_t, false_type) { return nullptr; }
+		
+		/// A window of at least \p n characters to write to directly, or \p nullptr if the appender does not provide one.
+		/// If the result is not \p nullptr it must be passed to commit().
+		template<class CharT, class Appender>
+		CharT* try_prepare(Appender& app, size_t n) { return try_prepare<CharT>(app, n, decltype(can_prepare<Appender>(0))()); }
+		
+		template<class Appender>
+		void try_commit(Appender& app, size_t used, true_type) { app.commit(used); }
+		template<class Appender>
+		void try_commit(Appender&, size_t, false_type) { }
+		
+		/// Commit the window returned by try_prepare().
+		template<class Appender>
+		void try_commit(Appender& app, size_t used) { try_commit(app, used, decltype(can_prepare<Appender>(0))()); }
+		
+		/// The allocator of the sink behind \p app if it has one (strings and small buffers), otherwise the default allocator.
+		template<class Appender>
+		auto sink_allocator(const Appender& app, int) -> decltype(app.get_allocator()) { return app.get_allocator(); }
+		template<class Appender>
+		allocator<char> sink_allocator(const Appender&, long) { return { }; }
+		
+		template<class CharT, class Appender>
+		using scratch_allocator_type = typename allocator_traits<decltype(sink_allocator(declval<const Appender&>(), 0))>::template rebind_alloc<CharT>;
+		
+		/// The allocator for temporaries needed while formatting to \p app.
+		/// Temporaries borrow the allocator of the destination, thus an arena backing the destination backs the whole format call.
+		template<class CharT, class Appender>
+		scratch_allocator_type<CharT, Appender> scratch_allocator(const Appender& app) { return scratch_allocator_type<CharT, Appender>(sink_allocator(app, 0)); }
+		
+		/// A temporary buffer using the allocator of \p Appender.
+		template<class CharT, class Appender>
+		using scratch_buffer = small_buffer<CharT, 256, scratch_allocator_type<CharT, Appender>>;
 	}
 	
+	/**
+	 A sink which converts the characters formatted into it from the encoding of \p CharT to the encoding of the character type of \p Sink.
+
+	 This allows formatting with a format string of one character type directly to a destination of another, e.g. with a \p u16string_view format string into a UTF-8 \p string,
+	 without formatting into a temporary string and converting that afterwards. \p Sink can be any destination usable with format(in_place, ...).
+	 The encoding is determined by the size of the character type: UTF-8, UTF-16 or UTF-32. Malformed sequences are replaced by U+FFFD.
+	 A sequence split between two appended fragments is kept until the next one, even across format() calls, thus the sink should be kept for the whole output.
+	 ```cpp
+	 string out;
+	 auto sink = make_transcoding_sink<char16_t>(out);
+	 format(in_place, sink, u"{0}: {1}", id, name);
+	 ```
+	 */
+	template<class CharT, class Sink>
+	class transcoding_sink
+	{
+	public:
+		using value_type = CharT;
+		
+		explicit transcoding_sink(Sink& sink) : _sink(&sink) { }
+		
+		Sink& base() const noexcept { return *_sink; }
+		/// Whether the output so far ends in the middle of a sequence.
+		bool incomplete() const noexcept { return _pending_size > 0; }
+		
+	private:
+		template<class Derived, class CharT2, class Sink2>
+		friend class detail::transcoding_appender;
+		
+		Sink* _sink;
+		CharT _pending[3]; // The start of a sequence whose remainder is expected in the next fragment
+		size_t _pending_size = 0;
+	};
+	
 	template<class Sink>
-	class format_appender : public decltype(detail::select_appender<format_appender<Sink>>(declval<Sink>()))
+	class format_appender : public decltype(detail::select_appender<format_appender<Sink>>(declval<Sink&>()))
 	{
-		using Base = decltype(detail::select_appender<format_appender<Sink>>(declval<Sink>()));
+		using Base = decltype(detail::select_appender<format_appender<Sink>>(declval<Sink&>()));
 		
 	public:
 		using Base::Base;
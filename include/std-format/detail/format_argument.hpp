@@ -0,0 +1,185 @@
+//
+//  format_argument.hpp
+//  std-format
+//
+//  Created by knejp on 2.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_argument_hpp
+#define std_format_detail_format_argument_hpp
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		template<class CharT, class Appender, class Arg, class FmtFlags>
+		size_t format_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment);
+
+		template<class CharT, class Appender, class Arg, class FmtFlags>
+		size_t align_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment, true_type in_place);
+
+		template<class CharT, class Appender, class Arg, class FmtFlags>
+		size_t align_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment, false_type in_place);
+
+		// Whether the appender can read back and move already written characters to measure them and insert padding in front of them
+		template<class Appender, class CharT>
+		auto can_pad_in_place(int) -> decltype(declval<Appender&>().pad_tail(size_t(), size_t(), CharT()), declval<Appender&>().tail(size_t()), true_type());
+		template<class Appender, class CharT>
+		false_type can_pad_in_place(long);
+
+		/// A table of functions parsing the format flags of the argument at the respective index.
+		/// The parsed state of argument \p I is appended to the \p I th vector of \p states_type and the function returns its position.
+		/// Arguments without a parse_format_flags() overload store nothing.
+		template<class CharT, class Traits, class... Args>
+		struct flags_parser_table
+		{
+			using states_type = tuple<vector<parsed_flags_type<Args, CharT, Traits>>...>;
+			using flags_type = basic_string_view<CharT, Traits>;
+			using function_type = size_t (*)(states_type& states, flags_type flags);
+
+			template<size_t I>
+			static size_t parse(states_type& states, flags_type flags)
+			{
+				using Arg = typename tuple_element<I, tuple<Args...>>::type;
+				return store<Arg>(get<I>(states), flags, has_parsed_flags<Arg, CharT, Traits>());
+			}
+
+			template<class Arg, class State>
+			static size_t store(vector<State>& states, flags_type flags, true_type)
+			{
+				states.push_back(parse_flags<Arg>(flags));
+				return states.size() - 1;
+			}
+
+			template<class Arg, class State>
+			static size_t store(vector<State>&, flags_type, false_type)
+			{
+				return 0;
+			}
+
+			template<size_t... I>
+			static constexpr array<function_type, sizeof...(I)> make(index_sequence<I...>)
+			{
+				return {{ &parse<I>... }};
+			}
+
+			static constexpr array<function_type, sizeof...(Args)> value = make(make_index_sequence<sizeof...(Args)>());
+		};
+
+		/// A table of plain function pointers formatting the argument at the respective index.
+		/// It is shared by all format calls with the same appender and argument types, thus dispatching an argument by its runtime index costs one indirect call.
+		/// If \p states is not null it holds the flags already parsed by flags_parser_table and \p slot selects the entry, otherwise the flags are parsed on every call.
+		template<class Appender, class CharT, class Traits, class... Args>
+		struct argument_table
+		{
+			using values_type = tuple<const Args&...>;
+			using flags_type = basic_string_view<CharT, Traits>;
+			using states_type = typename flags_parser_table<CharT, Traits, Args...>::states_type;
+			using function_type = size_t (*)(Appender& app, const values_type& values, const states_type* states, size_t slot, flags_type flags, format_alignment<CharT> alignment);
+
+			template<size_t I>
+			static size_t format(Appender& app, const values_type& values, const states_type* states, size_t slot, flags_type flags, format_alignment<CharT> alignment)
+			{
+				using Arg = typename tuple_element<I, tuple<Args...>>::type;
+				return format<I>(app, values, states, slot, flags, alignment, has_parsed_flags<Arg, CharT, Traits>());
+			}
+
+			template<size_t I>
+			static size_t format(Appender& app, const values_type& values, const states_type* states, size_t slot, flags_type flags, format_alignment<CharT> alignment, true_type)
+			{
+				using Arg = typename tuple_element<I, tuple<Args...>>::type;
+				if(states)
+					return format_argument(app, get<I>(values), get<I>(*states)[slot], alignment);
+				else
+					return format_argument(app, get<I>(values), parse_flags<Arg>(flags), alignment);
+			}
+
+			template<size_t I>
+			static size_t format(Appender& app, const values_type& values, const states_type*, size_t, flags_type flags, format_alignment<CharT> alignment, false_type)
+			{
+				return format_argument(app, get<I>(values), flags, alignment);
+			}
+
+			/// Format the argument at \p index whose flags contain escaped braces.
+			/// The unescaped flags only live as long as the argument is formatted, usually on the stack.
+			static size_t format_escaped(Appender& app, const values_type& values, size_t index, flags_type flags, format_alignment<CharT> alignment)
+			{
+				scratch_buffer<CharT, Appender> temp{ scratch_allocator<CharT>(app) };
+				for_each_unescaped(flags, [&](flags_type chunk) { temp.append(chunk.data(), chunk.size()); });
+				return value[index](app, values, nullptr, 0, { temp.data(), temp.size() }, alignment);
+			}
+
+			template<size_t... I>
+			static constexpr array<function_type, sizeof...(I)> make(index_sequence<I...>)
+			{
+				return {{ &format<I>... }};
+			}
+
+			static constexpr array<function_type, sizeof...(Args)> value = make(make_index_sequence<sizeof...(Args)>());
+		};
+	} // namespace detail
+}} // namespace std::experimental
+
+/// Format a single argument, padding it to the given width in columns.
+/// A width of zero disables alignment.
+template<class CharT, class Appender, class Arg, class FmtFlags>
+size_t std::experimental::detail::format_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment)
+{
+	if(alignment.width <= 0)
+		return dispatch_to_string(arg, app, flags);
+	else
+		return align_argument(app, arg, flags, alignment, decltype(can_pad_in_place<Appender, CharT>(0))());
+}
+
+/// The width is in columns while the appenders count code units, so the length of the value must be known before any padding is written.
+template<class CharT, class Appender, class Arg, class FmtFlags>
+size_t std::experimental::detail::align_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment, true_type)
+{
+	// Format directly into the destination, measure it there and shift the result once to make room for the leading padding.
+	// The length is taken from the appender so it is correct even if to_string() reports it wrong.
+	auto before = app.write_count();
+	dispatch_to_string(arg, app, flags);
+	auto n = app.write_count() - before;
+	auto tail = app.tail(n);
+	auto columns = display_width<CharT>(tail, tail + n);
+	auto width = static_cast<size_t>(alignment.width);
+	if(columns < width)
+	{
+		auto padding = width - columns;
+		auto leading = alignment.align == format_align::left ? 0 : alignment.align == format_align::center ? padding / 2 : padding;
+		if(leading > 0)
+			app.pad_tail(n, leading, alignment.fill);
+		app.append(padding - leading, alignment.fill);
+		n += padding;
+	}
+	return n;
+}
+
+template<class CharT, class Appender, class Arg, class FmtFlags>
+size_t std::experimental::detail::align_argument(Appender& app, const Arg& arg, const FmtFlags& flags, format_alignment<CharT> alignment, false_type)
+{
+	// Format the substring first to determine its width and prepend the padding if necessary.
+	// Like above the length is taken from what was written, not from what to_string() reports.
+	scratch_buffer<CharT, Appender> temp{ scratch_allocator<CharT>(app) };
+	auto app2 = make_format_appender(temp);
+	dispatch_to_string(arg, app2, flags);
+	auto columns = display_width<CharT>(temp.data(), temp.data() + temp.size());
+	auto width = static_cast<size_t>(alignment.width);
+	auto padding = columns < width ? width - columns : 0;
+	auto leading = alignment.align == format_align::left ? 0 : alignment.align == format_align::center ? padding / 2 : padding;
+	app.append(leading, alignment.fill);
+	app.append(temp.data(), temp.size());
+	app.append(padding - leading, alignment.fill);
+	return temp.size() + padding;
+}
+
+template<class CharT, class Traits, class... Args>
+constexpr std::array<typename std::experimental::detail::flags_parser_table<CharT, Traits, Args...>::function_type, sizeof...(Args)>
+	std::experimental::detail::flags_parser_table<CharT, Traits, Args...>::value;
+
+template<class Appender, class CharT, class Traits, class... Args>
+constexpr std::array<typename std::experimental::detail::argument_table<Appender, CharT, Traits, Args...>::function_type, sizeof...(Args)>
+	std::experimental::detail::argument_table<Appender, CharT, Traits, Args...>::value;
+
+#endif // std_format_detail_format_argument_hpp
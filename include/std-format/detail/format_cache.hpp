@@ -0,0 +1,210 @@
+//
+//  format_cache.hpp
+//  std-format
+//
+//  Created by knejp on 10.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_cache_hpp
+#define std_format_detail_format_cache_hpp
+
+#include <std-format/detail/format_program.hpp>
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////
+// basic_format_cache
+
+/**
+ A per-thread cache of parsed format strings used by format() for format strings only known at runtime.
+
+ Entries are identified by the address and length of the format string and verified against a copy of its content, so a reused buffer with different content never produces a wrong result.
+ The least recently used entry is evicted when the capacity is exceeded.
+ Since every thread has its own cache no synchronization is necessary.
+
+ Caching is opt-in, the capacity is zero initially:
+ ```cpp
+ format_cache::local().set_capacity(64);
+ ```
+ */
+template<class CharT, class Traits>
+class std::experimental::basic_format_cache
+{
+public:
+	using format_type = basic_string_view<CharT, Traits>;
+	using program_type = detail::format_program<CharT, Traits>;
+
+	/// The cache of the calling thread.
+	static basic_format_cache& local();
+
+	basic_format_cache() = default;
+	basic_format_cache(const basic_format_cache&) = delete;
+	basic_format_cache& operator= (const basic_format_cache&) = delete;
+
+	size_t capacity() const noexcept { return _capacity; }
+	size_t size() const noexcept { return _entries.size(); }
+	/// Setting the capacity to zero disables the cache.
+	void set_capacity(size_t capacity);
+	void clear();
+
+	format_cache_stats stats() const noexcept { return _stats; }
+	void reset_stats() noexcept { _stats = { }; }
+
+	/// Return the parsed program of \p fmt, parsing and inserting it if it is not in the cache yet.
+	/// The program stays valid even if it is evicted while in use.
+	shared_ptr<const program_type> lookup(format_type fmt, size_t nargs);
+
+	template<class... Args>
+	using states_type = typename detail::flags_parser_table<CharT, Traits, Args...>::states_type;
+
+	/// Like lookup(), but also return the flags of \p fmt parsed for the argument types \p Args.
+	/// The flags are parsed once and kept with the entry until it is evicted or used with other argument types.
+	template<class... Args>
+	pair<shared_ptr<const program_type>, shared_ptr<const states_type<Args...>>> lookup_parsed(format_type fmt);
+
+private:
+	struct key
+	{
+		const CharT* data;
+		size_t size;
+
+		bool operator== (const key& other) const { return data == other.data && size == other.size; }
+	};
+	struct key_hash
+	{
+		size_t operator() (const key& k) const { return hash<const CharT*>()(k.data) ^ hash<size_t>()(k.size); }
+	};
+
+	struct entry
+	{
+		key id;
+		basic_string<CharT, Traits> text;
+		size_t nargs; // The number of arguments the indices were checked against
+		shared_ptr<const program_type> program;
+		const void* states_id; // Identifies the argument types the states were parsed for
+		shared_ptr<const void> states;
+	};
+	using list_type = list<entry>;
+
+	void evict(size_t size);
+	entry* find(format_type fmt, size_t nargs);
+	entry* insert(format_type fmt, size_t nargs, shared_ptr<const program_type>& program);
+
+	list_type _entries; // Most recently used first
+	unordered_map<key, typename list_type::iterator, key_hash> _index;
+	size_t _capacity = 0;
+	format_cache_stats _stats = { };
+};
+
+template<class CharT, class Traits>
+auto std::experimental::basic_format_cache<CharT, Traits>::local() -> basic_format_cache&
+{
+	static thread_local basic_format_cache cache;
+	return cache;
+}
+
+template<class CharT, class Traits>
+void std::experimental::basic_format_cache<CharT, Traits>::set_capacity(size_t capacity)
+{
+	_capacity = capacity;
+	evict(capacity);
+}
+
+template<class CharT, class Traits>
+void std::experimental::basic_format_cache<CharT, Traits>::clear()
+{
+	_index.clear();
+	_entries.clear();
+}
+
+template<class CharT, class Traits>
+void std::experimental::basic_format_cache<CharT, Traits>::evict(size_t size)
+{
+	while(_entries.size() > size)
+	{
+		_index.erase(_entries.back().id);
+		_entries.pop_back();
+		++_stats.evictions;
+	}
+}
+
+template<class CharT, class Traits>
+auto std::experimental::basic_format_cache<CharT, Traits>::find(format_type fmt, size_t nargs) -> entry*
+{
+	auto found = _index.find({ fmt.data(), fmt.size() });
+	if(found == _index.end())
+		return nullptr;
+	auto iter = found->second;
+	if(iter->nargs <= nargs && Traits::compare(iter->text.data(), fmt.data(), fmt.size()) == 0)
+	{
+		++_stats.hits;
+		_entries.splice(_entries.begin(), _entries, iter);
+		return &*iter;
+	}
+	// Different content at the same address, or indices not checked against this many arguments
+	_entries.erase(iter);
+	_index.erase(found);
+	return nullptr;
+}
+
+template<class CharT, class Traits>
+auto std::experimental::basic_format_cache<CharT, Traits>::insert(format_type fmt, size_t nargs, shared_ptr<const program_type>& program) -> entry*
+{
+	++_stats.misses;
+	auto errors = detail::format_error_count();
+	program = make_shared<const program_type>(fmt, nargs);
+	// A program built while errors are collected instead of thrown is incomplete if any occurred
+	if(_capacity == 0 || detail::format_error_count() != errors)
+		return nullptr;
+	key id{ fmt.data(), fmt.size() };
+	evict(_capacity - 1);
+	_entries.push_front({ id, { fmt.data(), fmt.size() }, nargs, program, nullptr, nullptr });
+	_index[id] = _entries.begin();
+	return &_entries.front();
+}
+
+template<class CharT, class Traits>
+auto std::experimental::basic_format_cache<CharT, Traits>::lookup(format_type fmt, size_t nargs) -> shared_ptr<const program_type>
+{
+	if(auto e = find(fmt, nargs))
+		return e->program;
+	shared_ptr<const program_type> program;
+	insert(fmt, nargs, program);
+	return program;
+}
+
+template<class CharT, class Traits>
+template<class... Args>
+auto std::experimental::basic_format_cache<CharT, Traits>::lookup_parsed(format_type fmt)
+	-> pair<shared_ptr<const program_type>, shared_ptr<const states_type<Args...>>>
+{
+	using parser_table = detail::flags_parser_table<CharT, Traits, Args...>;
+	// The address of the parser table is unique for every list of argument types
+	const void* id = &parser_table::value;
+
+	shared_ptr<const program_type> program;
+	auto e = find(fmt, sizeof...(Args));
+	if(e)
+		program = e->program;
+	else
+		e = insert(fmt, sizeof...(Args), program);
+	if(e && e->states_id == id)
+		return { move(program), static_pointer_cast<const states_type<Args...>>(e->states) };
+
+	auto errors = detail::format_error_count();
+	auto states = make_shared<states_type<Args...>>();
+	program->for_each_argument([&states](size_t index, format_type flags) { parser_table::value[index](*states, flags); });
+	// Flags rejected while errors are collected must be reported again on the next call
+	if(e && detail::format_error_count() == errors)
+	{
+		e->states_id = id;
+		e->states = states;
+	}
+	return { move(program), move(states) };
+}
+
+#endif // std_format_detail_format_cache_hpp
@@ -0,0 +1,169 @@
+//
+//  format_error.hpp
+//  std-format
+//
+//  Created by knejp on 13.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_error_hpp
+#define std_format_detail_format_error_hpp
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+// Exceptions are used unless the compiler has them disabled, define STD_FORMAT_EXCEPTIONS to 0 or 1 to override the detection.
+#ifndef STD_FORMAT_EXCEPTIONS
+#	if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#		define STD_FORMAT_EXCEPTIONS 1
+#	else
+#		define STD_FORMAT_EXCEPTIONS 0
+#	endif
+#endif
+
+// Without exceptions an error which is not collected by an error_code terminates the program
+#if STD_FORMAT_EXCEPTIONS
+#	define STD_FORMAT_THROW(e) throw e
+#else
+#	define STD_FORMAT_THROW(e) (static_cast<void>(sizeof(e)), ::std::abort())
+#endif
+
+namespace std { namespace experimental
+{
+	/// Errors reported through \p error_code by the non-throwing overloads of validate_format() and format().
+	enum class format_errc
+	{
+		invalid_nesting = 1, // Unescaped closing brace outside of a format argument or opening brace inside one
+		unexpected_end, // Format argument not closed before the end of the format string
+		invalid_index, // Missing or malformed index
+		index_out_of_bounds, // Index not less than the number of arguments
+		invalid_width, // Malformed alignment width
+		unexpected_character, // Index/alignment not followed by ':' or '}'
+		invalid_flags, // Format flags rejected by the argument
+		format_too_large, // Format string exceeds the limits of a compiled program
+		buffer_overflow, // Destination range too small
+		write_failed, // Destination stream signalled an error
+	};
+
+	inline const error_category& format_category() noexcept;
+
+	inline error_code make_error_code(format_errc e) noexcept { return { static_cast<int>(e), format_category() }; }
+
+	namespace detail
+	{
+		class format_category_impl : public error_category
+		{
+		public:
+			const char* name() const noexcept override { return "format"; }
+			string message(int e) const override
+			{
+				switch(static_cast<format_errc>(e))
+				{
+					case format_errc::invalid_nesting: return "invalid nesting of braces in format string";
+					case format_errc::unexpected_end: return "unexpected end of format string";
+					case format_errc::invalid_index: return "invalid index in format argument";
+					case format_errc::index_out_of_bounds: return "index in format argument out of bounds";
+					case format_errc::invalid_width: return "invalid width in format argument";
+					case format_errc::unexpected_character: return "unexpected character in format argument";
+					case format_errc::invalid_flags: return "invalid format flags";
+					case format_errc::format_too_large: return "format string too large";
+					case format_errc::buffer_overflow: return "buffer overflow in format_appender";
+					case format_errc::write_failed: return "error writing to destination";
+				}
+				return "unknown format error";
+			}
+		};
+
+		/// The first error raised on a thread while a format_error_scope is active.
+		struct format_error_slot
+		{
+			format_errc code;
+			size_t position; // Offset into the format string, zero for errors outside of the format string
+			size_t count; // Number of errors raised, including the first
+		};
+
+		inline format_error_slot*& current_format_error() noexcept
+		{
+			static thread_local format_error_slot* slot = nullptr;
+			return slot;
+		}
+
+		/// While alive errors raised on this thread are collected instead of thrown.
+		/// Only the error_code entry points install one, the throwing ones suspend it with a format_throw_scope.
+		/// Scopes nest, the innermost one receives the errors.
+		class format_error_scope
+		{
+		public:
+			format_error_scope() noexcept : _previous(current_format_error()) { current_format_error() = &_slot; }
+			~format_error_scope() { current_format_error() = _previous; }
+			format_error_scope(const format_error_scope&) = delete;
+			format_error_scope& operator= (const format_error_scope&) = delete;
+
+			error_code error() const noexcept { return _slot.count > 0 ? make_error_code(_slot.code) : error_code{ }; }
+			size_t position() const noexcept { return _slot.position; }
+
+		private:
+			format_error_slot _slot{ format_errc{ }, 0, 0 };
+			format_error_slot* _previous;
+		};
+
+		/// While alive errors raised on this thread are thrown even if an enclosing format_error_scope collects them.
+		/// A throwing format() called from a to_string() inside format(ec, ...) thus reports to its own caller and not into the outer error_code.
+		class format_throw_scope
+		{
+		public:
+			format_throw_scope() noexcept : _previous(current_format_error()) { current_format_error() = nullptr; }
+			~format_throw_scope() { current_format_error() = _previous; }
+			format_throw_scope(const format_throw_scope&) = delete;
+			format_throw_scope& operator= (const format_throw_scope&) = delete;
+
+		private:
+			format_error_slot* _previous;
+		};
+
+		/// Record \p code in the active format_error_scope or throw the exception returned by \p make if there is none.
+		/// If this returns the caller must carry on as well as it can, the error is reported once formatting is complete.
+		template<class MakeException>
+		void raise_format_error(format_errc code, size_t position, MakeException make)
+		{
+			if(auto slot = current_format_error())
+			{
+				if(slot->count++ == 0)
+				{
+					slot->code = code;
+					slot->position = position;
+				}
+				return;
+			}
+			STD_FORMAT_THROW(make());
+		}
+
+		inline void raise_format_error(format_errc code, const char* message)
+		{
+			raise_format_error(code, 0, [message] { return runtime_error{message}; });
+		}
+
+		/// The number of errors raised in the active format_error_scope so far.
+		inline size_t format_error_count() noexcept
+		{
+			auto slot = current_format_error();
+			return slot ? slot->count : 0;
+		}
+	} // namespace detail
+
+	inline const error_category& format_category() noexcept
+	{
+		static const detail::format_category_impl category;
+		return category;
+	}
+}} // namespace std::experimental
+
+namespace std
+{
+	template<>
+	struct is_error_code_enum<experimental::format_errc> : true_type { };
+} // namespace std
+
+#endif // std_format_detail_format_error_hpp
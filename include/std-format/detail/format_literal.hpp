@@ -0,0 +1,296 @@
+//
+//  format_literal.hpp
+//  std-format
+//
+//  Created by knejp on 2.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_literal_hpp
+#define std_format_detail_format_literal_hpp
+
+// The _fmt suffix relies on the string literal operator template extension of GCC and Clang, define STD_FORMAT_LITERALS to 0 or 1 to override the detection.
+#ifndef STD_FORMAT_LITERALS
+#	if defined(__GNUC__)
+#		define STD_FORMAT_LITERALS 1
+#	else
+#		define STD_FORMAT_LITERALS 0
+#	endif
+#endif
+
+namespace std { namespace experimental
+{
+	/**
+	 A format string whose characters are encoded in its type.
+
+	 The string is parsed during compilation into a fixed table of components and formatting emits one straight-line append per component without any runtime parsing.
+	 Indices are checked against the number of arguments at compile time and malformed strings are rejected by the compiler.
+	 Objects of this type are created with the \p _fmt literal suffix and can be used wherever a format string is accepted.
+	 The suffix is a compiler extension and only available if \p STD_FORMAT_LITERALS is set:
+	 ```cpp
+	 using namespace std::experimental::format_literals;
+	 auto str = format("{0}, {1,*^8:flags}"_fmt, a, b);
+	 ```
+	 */
+	template<class CharT, CharT... Chars>
+	class basic_format_literal;
+
+	inline namespace literals
+	{
+		inline namespace format_literals
+		{
+#if STD_FORMAT_LITERALS
+#	pragma GCC diagnostic push
+#	pragma GCC diagnostic ignored "-Wpedantic"
+#	ifdef __clang__
+#		pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#	endif
+			template<class CharT, CharT... Chars>
+			constexpr basic_format_literal<CharT, Chars...> operator"" _fmt() { return { }; }
+#	pragma GCC diagnostic pop
+#endif
+		}
+	}
+
+	namespace detail
+	{
+		template<class CharT>
+		struct static_format_component
+		{
+			format_component_type type;
+			size_t offset; // Position in the text table
+			size_t length;
+			size_t index;
+			format_alignment<CharT> alignment;
+		};
+
+		/// A format string compiled to a table of components.
+		/// Static substrings and unescaped flags are stored consecutively in \p text, with adjacent static substrings merged into one.
+		template<class CharT, size_t TextSize, size_t Size>
+		struct static_format_program
+		{
+			CharT text[TextSize];
+			static_format_component<CharT> components[Size];
+			size_t size; // Number of components used
+			size_t arguments; // Minimum number of arguments required by the indices
+		};
+
+		// Never called during constant evaluation, thus turning any call to it into a compile error containing the message.
+		// Outside of one it fails like invalid_checked_format(), so a malformed literal is never used even with NDEBUG.
+		[[noreturn]] inline void invalid_format_literal(const char* message) { STD_FORMAT_THROW(runtime_error{message}); }
+
+		/// Pass the message describing \p status to \p report unless it is \p ok.
+		constexpr bool check_format_syntax(format_syntax_status status, void (*report)(const char*) = invalid_format_literal)
+		{
+			switch(status)
+			{
+				case format_syntax_status::ok:
+					break;
+				case format_syntax_status::invalid_nesting:
+					report("Invalid nesting of braces in format string.");
+					break;
+				case format_syntax_status::unexpected_end:
+					report("Reached unexpected end of format string while parsing format argument.");
+					break;
+				case format_syntax_status::invalid_index:
+					report("Invalid index in format argument.");
+					break;
+				case format_syntax_status::index_out_of_bounds:
+					report("Index in format argument out of bounds.");
+					break;
+				case format_syntax_status::invalid_width:
+					report("Invalid width in format argument.");
+					break;
+				case format_syntax_status::unexpected_character:
+					report("Unexpected character after index/alignment in format argument.");
+					break;
+			}
+			return status == format_syntax_status::ok;
+		}
+
+		/// Compiles a format string into a static_format_program, or only counts the number of components if no program is given.
+		template<class CharT, class Traits, class Program>
+		class format_literal_compiler
+		{
+		public:
+			constexpr format_literal_compiler(Program* program) : _program(program) { }
+
+			/// Returns the number of components.
+			constexpr size_t compile(const CharT* first, const CharT* last)
+			{
+				auto iter = first;
+				while(iter != last)
+				{
+					auto brace = find_brace<CharT, Traits>(iter, last);
+					if(brace == last)
+					{
+						add_text(iter, last);
+						iter = last;
+					}
+					else if(is_escaped_brace<CharT, Traits>(brace, last))
+					{
+						// Keep the first brace, drop the second
+						add_text(iter, brace + 1);
+						iter = brace + 2;
+					}
+					else
+					{
+						add_text(iter, brace);
+						auto arg = scan_format_argument<CharT, Traits>(brace, last, numeric_limits<size_t>::max());
+						check_format_syntax(arg.status);
+						add_argument(arg);
+						iter = arg.pos;
+					}
+				}
+				if(_program)
+					_program->size = _size;
+				return _size;
+			}
+
+		private:
+			constexpr void add_text(const CharT* first, const CharT* last)
+			{
+				if(first == last)
+					return;
+				if(!_merge)
+				{
+					if(_program)
+						_program->components[_size] = { format_component_type::static_substring, _text, 0, 0, { CharT(' '), format_align::right, 0 } };
+					++_size;
+					_merge = true;
+				}
+				for( ; first != last; ++first)
+					append(*first);
+			}
+
+			constexpr void add_argument(const format_argument_syntax<CharT, const CharT*>& arg)
+			{
+				if(_program)
+				{
+					_program->components[_size] = { format_component_type::format_argument, _text, 0, arg.index, arg.alignment };
+					if(_program->arguments <= arg.index)
+						_program->arguments = arg.index + 1;
+				}
+				++_size;
+				_merge = false;
+				// Flags are stored unescaped, every brace in them is known to be followed by its duplicate
+				for(auto flags = arg.flags_first; flags != arg.flags_last; ++flags)
+				{
+					append(*flags);
+					if(arg.flags_escaped && (Traits::eq(*flags, CharT('{')) || Traits::eq(*flags, CharT('}'))))
+						++flags;
+				}
+			}
+
+			constexpr void append(CharT ch)
+			{
+				if(_program)
+				{
+					_program->text[_text] = ch;
+					++_program->components[_size - 1].length;
+				}
+				++_text;
+			}
+
+			Program* _program;
+			size_t _size = 0;
+			size_t _text = 0;
+			bool _merge = false; // Whether the previous component is a static substring we can extend
+		};
+
+		template<class CharT, class Traits>
+		constexpr size_t count_format_literal_components(const CharT* first, const CharT* last)
+		{
+			return format_literal_compiler<CharT, Traits, static_format_program<CharT, 1, 1>>{ nullptr }.compile(first, last);
+		}
+
+		template<class CharT, class Traits, size_t TextSize, size_t Size>
+		constexpr auto make_format_literal_program(const CharT* first, const CharT* last)
+			-> static_format_program<CharT, TextSize, Size>
+		{
+			static_format_program<CharT, TextSize, Size> program{ };
+			format_literal_compiler<CharT, Traits, static_format_program<CharT, TextSize, Size>>{ &program }.compile(first, last);
+			return program;
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+////////////////////////////////////////////////////////////////////////////
+// basic_format_literal
+
+template<class CharT, CharT... Chars>
+class std::experimental::basic_format_literal
+{
+public:
+	using value_type = CharT;
+	using traits_type = char_traits<CharT>;
+
+	static constexpr size_t size() noexcept { return sizeof...(Chars); }
+	static constexpr const value_type* data() noexcept { return _str; }
+
+	operator basic_string_view<value_type, traits_type>() const noexcept { return { data(), size() }; }
+
+	template<class Appender, class... Args>
+	size_t operator() (Appender& app, const Args&... args) const
+	{
+		static_assert(_program.arguments <= sizeof...(Args), "Index in format literal out of bounds.");
+		return execute(app, std::tie(args...), make_index_sequence<_program.size>());
+	}
+
+private:
+	using flags_type = basic_string_view<value_type, traits_type>;
+
+	template<class Appender, class Values, size_t... I>
+	static size_t execute(Appender& app, const Values& values, index_sequence<I...>)
+	{
+		size_t printed = 0;
+		using expand = int[];
+		(void)expand{ 0, (printed += execute_component<I>(app, values, integral_constant<format_component_type, _program.components[I].type>()), 0)... };
+		return printed;
+	}
+
+	template<size_t I, class Appender, class Values>
+	static size_t execute_component(Appender& app, const Values&, integral_constant<format_component_type, format_component_type::static_substring>)
+	{
+		app.append(_program.text + _program.components[I].offset, _program.components[I].length);
+		return 0;
+	}
+
+	template<size_t I, class Appender, class Values>
+	static size_t execute_component(Appender& app, const Values& values, integral_constant<format_component_type, format_component_type::format_argument>)
+	{
+		constexpr auto component = _program.components[I];
+		using Arg = typename remove_cv<typename remove_reference<decltype(get<component.index>(values))>::type>::type;
+		constexpr flags_type flags{ _program.text + component.offset, component.length };
+		// The flags never change, parse them only once unless they were rejected while errors are collected
+		static const auto parsed = parse_once<Arg>(flags);
+		if(parsed.second)
+			return detail::format_argument(app, get<component.index>(values), parsed.first, component.alignment);
+		// Parse again so the error is reported on every call
+		return detail::format_argument(app, get<component.index>(values), detail::parse_flags<Arg>(flags), component.alignment);
+	}
+
+	template<class Arg>
+	static auto parse_once(flags_type flags) -> pair<decltype(detail::parse_flags<Arg>(flags)), bool>
+	{
+		auto errors = detail::format_error_count();
+		auto parsed = detail::parse_flags<Arg>(flags);
+		return { move(parsed), detail::format_error_count() == errors };
+	}
+
+	static constexpr value_type _str[] = { Chars..., value_type() };
+	static constexpr size_t _size = detail::count_format_literal_components<value_type, traits_type>(_str, _str + sizeof...(Chars));
+	using program_type = detail::static_format_program<value_type, sizeof...(Chars) + 1, _size + 1>;
+	static constexpr program_type _program = detail::make_format_literal_program<value_type, traits_type, sizeof...(Chars) + 1, _size + 1>(_str, _str + sizeof...(Chars));
+};
+
+template<class CharT, CharT... Chars>
+constexpr CharT std::experimental::basic_format_literal<CharT, Chars...>::_str[];
+
+template<class CharT, CharT... Chars>
+constexpr size_t std::experimental::basic_format_literal<CharT, Chars...>::_size;
+
+template<class CharT, CharT... Chars>
+constexpr typename std::experimental::basic_format_literal<CharT, Chars...>::program_type std::experimental::basic_format_literal<CharT, Chars...>::_program;
+
+#endif // std_format_detail_format_literal_hpp
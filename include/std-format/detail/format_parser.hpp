@@ -9,7 +9,8 @@
 #ifndef std_format_detail_parser_hpp
 #define std_format_detail_parser_hpp
 
-#include <std-format/detail/parse_tools.hpp>
+#include <std-format/detail/brace_scanner.hpp>
+#include <std-format/detail/format_syntax.hpp>
 
 namespace std { namespace experimental
 {
@@ -28,7 +29,10 @@ namespace std { namespace experimental
 		basic_string_view<CharT, Traits> substring;
 		int counter;
 		size_t index;
-		int width;
+		detail::format_alignment<CharT> alignment;
+		/// The flags of a format argument contain escaped braces and \p substring refers to them as they are in the format string.
+		/// detail::for_each_unescaped() yields the unescaped flags in chunks without copying.
+		bool flags_escaped = false;
 	};
 
 	template<class CharT, class Traits, class FormatIter>
@@ -41,12 +45,37 @@ namespace std { namespace experimental
 		return parse_format<CharT, Traits>(fmt.begin(), fmt.end(), nargs);
 	}
 
+	namespace detail
+	{
+		/// The error code reported for a malformed format argument, \p status must not be \p ok.
+		constexpr format_errc to_format_errc(format_syntax_status status)
+		{
+			switch(status)
+			{
+				case format_syntax_status::ok:
+				case format_syntax_status::invalid_nesting:
+					break;
+				case format_syntax_status::unexpected_end:
+					return format_errc::unexpected_end;
+				case format_syntax_status::invalid_index:
+					return format_errc::invalid_index;
+				case format_syntax_status::index_out_of_bounds:
+					return format_errc::index_out_of_bounds;
+				case format_syntax_status::invalid_width:
+					return format_errc::invalid_width;
+				case format_syntax_status::unexpected_character:
+					return format_errc::unexpected_character;
+			}
+			return format_errc::invalid_nesting;
+		}
+	} // namespace detail
 }} // namespace std::experimental
 
 ////////////////////////////////////////////////////////////////////////////
 // format_parser
 
 // This could be made a public class if people think it would be useful
+// The components refer to the format string only, thus they stay valid while iterating and parsing allocates no memory.
 template<class CharT, class Traits, class FormatIter>
 class std::experimental::format_parser
 {
@@ -69,25 +98,24 @@ private:
 	
 	// Extract the next substring out of the format source
 	pair<component, FormatIter> parse_next(FormatIter iter, int n);
+	using syntax = detail::format_argument_syntax<CharT, FormatIter>;
+	
 	// Process a format argument
 	pair<component, FormatIter> parse_argument(FormatIter lbrace, int n);
+	// Describe the syntax error in \p arg for the exception thrown
+	string error_message(const syntax& arg, FormatIter lbrace, int n) const;
 	// Mnemonic for creating a static substring object
 	pair<component, FormatIter> static_substring(FormatIter first, FormatIter last, FormatIter next, int n);
-	// Skip all characters until an unescaped brace is encountered and return its iterator or \p last if none was found.
-	FormatIter skip_until_unescaped(FormatIter first, FormatIter last);
-	/// Parse the unsigned integer starting at the given position and also return the iterator to the first position past the number.
-	pair<size_t, FormatIter> parseIndex(FormatIter first, FormatIter last, FormatIter start, size_t n);
-	// Parse the signed(!) integer starting at the given position and also return the iterator to the first position past the number.
-	pair<int, FormatIter> parseWidth(FormatIter first, FormatIter last, FormatIter start, size_t n);
 	// Find the next brace and return its iterator or \p last if none was found.
 	FormatIter nextBrace(FormatIter first, FormatIter last);
 
 	bool is_escaped(FormatIter brace);
+	// Error messages are always narrow, replace everything outside of ASCII
+	static char message_char(CharT ch) { return ch >= CharT(0) && ch < CharT(0x80) ? static_cast<char>(ch) : '?'; }
 
 	FormatIter _first;
 	FormatIter _last;
 	size_t _nargs;
-	basic_string<CharT, Traits> _temp; // This buffer is used for all temporaries we need, thus hopefully minimizing the number of reallocations
 };
 
 template<class CharT, class Traits, class FormatIter>
@@ -175,108 +203,70 @@ template<class CharT, class Traits, class FormatIter>
 auto std::experimental::format_parser<CharT, Traits, FormatIter>::parse_argument(FormatIter lbrace, int n)
 	-> pair<component, FormatIter>
 {
-	if(CharT('{') != *lbrace)
-		throw runtime_error{format("{0}: Invalid nesting of braces in format string.", lbrace - _first)};
-
-	auto pos = ++lbrace;
-	auto rbrace = skip_until_unescaped(pos, _last);
-	if(pos == _last)
-	{
-		throw runtime_error{format("{0}: Reached unexpected end of format string while parsing format argument #{1} (opening brace at {2})",
-								   pos - _first, n, lbrace - _first)};
-	}
-	unsigned index;
-	std::tie(index, pos) = parseIndex(pos, rbrace, _first, n);
-	if(index >= _nargs)
-	{
-		throw runtime_error{format("{0}: Index in format argument #{1} out of bounds ({2} specified, max allowed is {3}).",
-								   pos - _first, n, index, _nargs - 1)};
-	}
-	int width = 0;
-	if(CharT(',') == *pos)
-	{
-		++pos;
-		std::tie(width, pos) = parseWidth(pos, rbrace, _first, n);
-		
-	}
-	if(CharT(':') == *pos)
-		++pos;
-	else if(CharT('}') != *pos)
-	{
-		// If index/align is not followed by a colon it must be closed immediately
-		throw runtime_error{format("{0}: Unexpected character '{1}' after index/alignment in format argument #{2}.",
-								   pos - _first, *pos, n)};
-	}
-	auto next_brace = nextBrace(pos, rbrace);
-	if(next_brace != rbrace)
+	using detail::format_syntax_status;
+	
+	auto arg = detail::scan_format_argument<CharT, Traits, detail::block_brace_search>(lbrace, _last, _nargs);
+	if(arg.status != format_syntax_status::ok)
 	{
-		// The format options contain escaped braces.
-		// We need to assemble the escaped string in our temporary buffer and return that
-		_temp.clear();
-		for(auto part : format_parser{pos, rbrace, 0})
-			_temp.append(part.substring.data(), part.substring.size());
-		return { { format_component_type::format_argument, _temp, n, index, width }, ++rbrace };
+		// The message is only assembled if it is thrown.
+		// If errors are collected instead parsing ends here.
+		// The position reported through error_code is the brace opening the malformed argument
+		detail::raise_format_error(detail::to_format_errc(arg.status), static_cast<size_t>(lbrace - _first),
+								   [&] { return runtime_error{error_message(arg, lbrace, n)}; });
+		return static_substring(_last, _last, _last, n);
 	}
-	else
-		return { { format_component_type::format_argument, { pos, rbrace }, n, index, width }, ++rbrace };
+	// Escaped braces are left in the flags, unescaping them is up to the consumer
+	return { { format_component_type::format_argument, { arg.flags_first, arg.flags_last }, n, arg.index, arg.alignment, arg.flags_escaped }, arg.pos };
 }
 
 template<class CharT, class Traits, class FormatIter>
 auto std::experimental::format_parser<CharT, Traits, FormatIter>
-	::static_substring(FormatIter first, FormatIter last, FormatIter next, int n) -> pair<component, FormatIter>
+	::error_message(const syntax& arg, FormatIter lbrace, int n) const -> string
 {
-	return { { format_component_type::static_substring, { first, last }, n, 0, 0 }, next };
-}
-
-template<class CharT, class Traits, class FormatIter>
-auto std::experimental::format_parser<CharT, Traits, FormatIter>
-	::skip_until_unescaped(FormatIter first, FormatIter last) -> FormatIter
-{
-	while(true)
+	using detail::format_syntax_status;
+	
+	switch(arg.status)
 	{
-		auto brace = nextBrace(first, last);
-		if(brace == last)
-			return last;
-		else if(*(brace + 1) == *brace)
-			first = brace + 2;
-			else
-				return brace;
+		case format_syntax_status::ok:
+			break;
+		case format_syntax_status::invalid_nesting:
+			return format("{0}: Invalid nesting of braces in format string.", arg.pos - _first);
+		case format_syntax_status::unexpected_end:
+			return format("{0}: Reached unexpected end of format string while parsing format argument #{1} (opening brace at {2})",
+						  arg.pos - _first, n, lbrace - _first);
+		case format_syntax_status::invalid_index:
+			return format("{0}: Invalid index in format string parameter #{1}.", arg.pos - _first, n);
+		case format_syntax_status::index_out_of_bounds:
+			return format("{0}: Index in format argument #{1} out of bounds ({2} specified, max allowed is {3}).",
+						  arg.pos - _first, n, arg.index, _nargs - 1);
+		case format_syntax_status::invalid_width:
+			return format("{0}: Invalid width in format string parameter #{1}.", arg.pos - _first, n);
+		case format_syntax_status::unexpected_character:
+			return format("{0}: Unexpected character '{1}' after index/alignment in format argument #{2}.",
+						  arg.pos - _first, message_char(*arg.pos), n);
 	}
-}
-
-template<class CharT, class Traits, class FormatIter>
-bool std::experimental::format_parser<CharT, Traits, FormatIter>::is_escaped(FormatIter brace)
-{
-	assert(brace != _last);
-	return (brace + 1) != _last && *(brace + 1) == *brace;
+	return { };
 }
 
 template<class CharT, class Traits, class FormatIter>
 auto std::experimental::format_parser<CharT, Traits, FormatIter>
-	::parseIndex(FormatIter first, FormatIter last, FormatIter start, size_t n) -> pair<size_t, FormatIter>
+	::static_substring(FormatIter first, FormatIter last, FormatIter next, int n) -> pair<component, FormatIter>
 {
-	auto i = parse_integer<size_t, FormatIter, CharT, Traits>(first, last, 10);
-	if(!i.first)
-		throw runtime_error{format("{0}: Invalid index in format string parameter #{1}.", first - start, n)};
-	return { *i.first, i.second };
+	return { { format_component_type::static_substring, { first, last }, n, 0, { CharT(' '), format_align::right, 0 } }, next };
 }
 
 template<class CharT, class Traits, class FormatIter>
-auto std::experimental::format_parser<CharT, Traits, FormatIter>
-	::parseWidth(FormatIter first, FormatIter last, FormatIter start, size_t n) -> pair<int, FormatIter>
+bool std::experimental::format_parser<CharT, Traits, FormatIter>::is_escaped(FormatIter brace)
 {
-	auto i = parse_integer<int, FormatIter, CharT, Traits>(first, last, 10);
-	if(!i.first)
-		throw runtime_error{format("{0}: Invalid width in format string parameter #{1}.", first - start, n)};
-	return { *i.first, i.second };
+	assert(brace != _last);
+	return detail::is_escaped_brace<CharT, Traits>(brace, _last);
 }
 
 template<class CharT, class Traits, class FormatIter>
 auto std::experimental::format_parser<CharT, Traits, FormatIter>
 	::nextBrace(FormatIter first, FormatIter last) -> FormatIter
 {
-	auto chars = { CharT('{'), CharT('}') };
-	return find_first_of(first, last, chars.begin(), chars.end(), Traits::eq);
+	return detail::scan_brace<CharT, Traits>(first, last);
 }
 
 #endif // std_format_detail_parser_hpp
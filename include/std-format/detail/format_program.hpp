@@ -0,0 +1,166 @@
+//
+//  format_program.hpp
+//  std-format
+//
+//  Created by knejp on 3.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_program_hpp
+#define std_format_detail_format_program_hpp
+
+#include <cstdint>
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		/// A single step of a format_program packed into 16 bytes, so four of them share a cache line.
+		/// Static substrings copy [offset, offset + length) of the text buffer,
+		/// format arguments format argument #index with flags [offset, offset + length) of the same buffer.
+		struct format_instruction
+		{
+			static constexpr uint16_t text = 0xFFFF; // Value of index for static substrings
+			
+			uint32_t offset;
+			uint32_t length;
+			uint16_t index;
+			uint16_t slot; // Position of the parsed flags in the state table of the argument
+			uint32_t alignment; // One past the position in the alignment table, zero if the argument is not padded
+		};
+
+		template<class CharT, class Traits>
+		class format_program;
+	} // namespace detail
+}} // namespace std::experimental
+
+////////////////////////////////////////////////////////////////////////////
+// format_program
+
+/**
+ A parsed format string stored as a contiguous array of instructions.
+
+ Static substrings and flags are copied to (and unescaped in) a buffer owned by the program, therefore the only allocations happen during construction.
+ The program does not keep a reference to the format string it was built from, which makes it relocatable together with its owner.
+ Static substrings separated only by escaped braces end up next to each other in the buffer and are merged into a single instruction.
+ Instructions refer to the buffer by 32 bit offsets and to arguments by 16 bit indices, larger format strings are rejected on construction.
+ */
+template<class CharT, class Traits>
+class std::experimental::detail::format_program
+{
+public:
+	using format_type = basic_string_view<CharT, Traits>;
+
+	format_program() = default;
+	/// The slot of every argument is the number of its previous occurrences, matching the slots handed out by flags_parser_table.
+	/// The parsed flags can thus be added later with for_each_argument() without rebuilding the program.
+	format_program(format_type fmt, size_t nargs) : format_program(fmt, nargs, occurrence_counter{ vector<size_t>(nargs) }) { }
+	/// \p parse_flags is called as `parse_flags(index, flags)` for every argument and returns the slot of the parsed flags passed to the table on execution.
+	template<class ParseFlags>
+	format_program(format_type fmt, size_t nargs, ParseFlags parse_flags);
+
+	template<class Appender, class Table, class Values, class States>
+	size_t operator() (Appender& app, const Table& table, const Values& values, const States* states) const;
+
+	/// Call `f(index, flags)` for every format argument in the order they were parsed.
+	template<class F>
+	void for_each_argument(F f) const
+	{
+		for(const auto& instruction : _code)
+			if(instruction.index != format_instruction::text)
+				f(instruction.index, format_type{ _text.data() + instruction.offset, instruction.length });
+	}
+
+	/// Number of instructions executed by every invocation.
+	size_t size() const noexcept { return _code.size(); }
+
+private:
+	struct occurrence_counter
+	{
+		vector<size_t> counts;
+		size_t operator() (size_t index, format_type) { return counts[index]++; }
+	};
+
+
+	template<class T>
+	static bool fits(size_t value)
+	{
+		if(value <= numeric_limits<T>::max())
+			return true;
+		raise_format_error(format_errc::format_too_large, "Format string too large to be compiled.");
+		return false;
+	}
+	
+	vector<format_instruction> _code;
+	vector<format_alignment<CharT>> _alignments; // Only arguments with a width have an entry
+	basic_string<CharT, Traits> _text; // Unescaped static substrings and flags
+};
+
+template<class CharT, class Traits>
+template<class ParseFlags>
+std::experimental::detail::format_program<CharT, Traits>::format_program(format_type fmt, size_t nargs, ParseFlags parse_flags)
+{
+	// Indices must not collide with format_instruction::text
+	if(!fits<uint32_t>(fmt.size()) || !fits<uint16_t>(nargs + 1))
+		return;
+	for(const auto& component : parse_format(fmt, nargs))
+	{
+		if(component.type == format_component_type::static_substring)
+		{
+			if(component.substring.size() == 0)
+				continue;
+			auto offset = static_cast<uint32_t>(_text.size());
+			auto length = static_cast<uint32_t>(component.substring.size());
+			_text.append(component.substring.data(), component.substring.size());
+			// Substrings only separated by escaped braces are contiguous in the buffer, merge them into a single run
+			if(!_code.empty() && _code.back().index == format_instruction::text)
+				_code.back().length += length;
+			else
+				_code.push_back({ offset, length, format_instruction::text, 0, 0 });
+		}
+		else if(component.type == format_component_type::format_argument)
+		{
+			auto offset = _text.size();
+			if(component.flags_escaped)
+				for_each_unescaped(component.substring, [this](format_type chunk) { _text.append(chunk.data(), chunk.size()); });
+			else
+				_text.append(component.substring.data(), component.substring.size());
+			auto length = _text.size() - offset;
+			auto slot = parse_flags(component.index, format_type{ _text.data() + offset, length });
+			if(!fits<uint32_t>(_text.size()) || !fits<uint16_t>(slot))
+				break;
+			uint32_t alignment = 0;
+			if(component.alignment.width > 0)
+			{
+				_alignments.push_back(component.alignment);
+				alignment = static_cast<uint32_t>(_alignments.size());
+			}
+			_code.push_back({ static_cast<uint32_t>(offset), static_cast<uint32_t>(length), static_cast<uint16_t>(component.index), static_cast<uint16_t>(slot), alignment });
+		}
+	}
+	_code.shrink_to_fit();
+	_alignments.shrink_to_fit();
+	_text.shrink_to_fit();
+}
+
+template<class CharT, class Traits>
+template<class Appender, class Table, class Values, class States>
+size_t std::experimental::detail::format_program<CharT, Traits>
+	::operator() (Appender& app, const Table& table, const Values& values, const States* states) const
+{
+	size_t printed = 0;
+	auto text = _text.data();
+	for(const auto& instruction : _code)
+	{
+		if(instruction.index == format_instruction::text)
+			app.append(text + instruction.offset, instruction.length);
+		else
+		{
+			auto alignment = instruction.alignment == 0 ? format_alignment<CharT>{ CharT(' '), format_align::right, 0 } : _alignments[instruction.alignment - 1];
+			printed += table[instruction.index](app, values, states, instruction.slot, { text + instruction.offset, instruction.length }, alignment);
+		}
+	}
+	return printed;
+}
+
+#endif // std_format_detail_format_program_hpp
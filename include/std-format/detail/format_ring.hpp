@@ -0,0 +1,224 @@
+//
+//  format_ring.hpp
+//  std-format
+//
+//  Created by knejp on 12.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_ring_hpp
+#define std_format_detail_format_ring_hpp
+
+#include <atomic>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////
+// basic_format_ring
+
+/**
+ A multi-producer single-consumer ring buffer of formatted records.
+
+ Any number of threads may reserve space for a record, format directly into it and publish it.
+ A single consumer reads the published records in the order they were reserved with consume().
+ Reserving is a single compare-and-swap, publishing a single store, neither side takes a lock.
+
+ The buffer is divided into slots of slot_size characters. A record occupies one or more consecutive slots and is never split at the end of the buffer.
+ For every slot there is a state word which is set when a record starting at that slot is published and cleared when it is consumed.
+ The consumer stops at the first record which is reserved but not yet published, therefore a slow producer delays the records reserved after it.
+ */
+template<class CharT, class Traits>
+class std::experimental::basic_format_ring
+{
+public:
+	using value_type = CharT;
+	using traits_type = Traits;
+	using string_view_type = basic_string_view<CharT, Traits>;
+
+	/// The granularity of reservations in characters.
+	static constexpr size_t slot_size = 16;
+
+	class reservation;
+
+	/// \p capacity is in characters and rounded up to a power of two of at least slot_size.
+	explicit basic_format_ring(size_t capacity);
+	basic_format_ring(const basic_format_ring&) = delete;
+	basic_format_ring& operator= (const basic_format_ring&) = delete;
+
+	size_t capacity() const noexcept { return _slots * slot_size; }
+	/// The number of reservations which failed because the buffer was full.
+	size_t dropped() const noexcept { return _dropped.load(memory_order_relaxed); }
+
+	/// Reserve room for a record of up to \p n characters.
+	/// The result evaluates to \p false if there is not enough room.
+	/// May be called by any number of threads concurrently.
+	reservation reserve(size_t n);
+
+	/// Call `f(string_view_type)` for every published record in order.
+	/// The view refers to the buffer and is only valid during the call.
+	/// Returns the number of records consumed. Must only be called by one thread at a time.
+	/// If \p f throws the record is not consumed and passed again on the next call.
+	template<class F>
+	size_t consume(F f);
+
+private:
+	// Layout of a state word: bit 0 is set if published, bit 1 if the slots are padding,
+	// bits 2 to 31 hold the number of slots and bits 32 to 63 the number of characters.
+	static constexpr uint64_t published = 1;
+	static constexpr uint64_t padding = 2;
+
+	static uint64_t make_state(size_t slots, size_t length, uint64_t flags) { return (uint64_t(length) << 32) | (uint64_t(slots) << 2) | flags; }
+	static size_t state_slots(uint64_t state) { return static_cast<size_t>((state >> 2) & 0x3FFFFFFF); }
+	static size_t state_length(uint64_t state) { return static_cast<size_t>(state >> 32); }
+
+	void publish(size_t slot, size_t slots, size_t length, uint64_t flags) { _states[slot].store(make_state(slots, length, flags), memory_order_release); }
+
+	unique_ptr<CharT[]> _data;
+	unique_ptr<atomic<uint64_t>[]> _states;
+	size_t _slots;
+	atomic<size_t> _head{0}; // First slot not consumed yet, counting from construction
+	atomic<size_t> _tail{0}; // First slot not reserved yet, counting from construction
+	atomic<size_t> _dropped{0};
+};
+
+/**
+ Space reserved for a single record in a basic_format_ring.
+
+ It is a range with begin() and end() and therefore usable as destination of format(in_place, ...).
+ publish() makes the first \p n written characters visible to the consumer.
+ If it is destroyed without being published the slots are released as padding, so an exception while formatting does not block the consumer.
+ */
+template<class CharT, class Traits>
+class std::experimental::basic_format_ring<CharT, Traits>::reservation
+{
+public:
+	reservation() = default;
+	reservation(reservation&& other) noexcept
+		: _ring(other._ring), _data(other._data), _size(other._size), _slot(other._slot), _slots(other._slots)
+	{
+		other._ring = nullptr;
+	}
+	reservation& operator= (reservation&& other) noexcept
+	{
+		swap(_ring, other._ring);
+		swap(_data, other._data);
+		swap(_size, other._size);
+		swap(_slot, other._slot);
+		swap(_slots, other._slots);
+		return *this;
+	}
+	~reservation()
+	{
+		if(_ring)
+			_ring->publish(_slot, _slots, 0, published | padding);
+	}
+
+	explicit operator bool() const noexcept { return _ring != nullptr; }
+
+	CharT* data() noexcept { return _data; }
+	size_t size() const noexcept { return _size; }
+	CharT* begin() noexcept { return _data; }
+	CharT* end() noexcept { return _data + _size; }
+
+	/// Publish the first \p n characters, the rest of the reservation is skipped by the consumer.
+	void publish(size_t n)
+	{
+		assert(_ring && n <= _size);
+		_ring->publish(_slot, _slots, n, published);
+		_ring = nullptr;
+	}
+	void publish() { publish(_size); }
+
+private:
+	friend class basic_format_ring;
+
+	reservation(basic_format_ring* ring, CharT* data, size_t size, size_t slot, size_t slots)
+		: _ring(ring), _data(data), _size(size), _slot(slot), _slots(slots) { }
+
+	basic_format_ring* _ring = nullptr;
+	CharT* _data = nullptr;
+	size_t _size = 0;
+	size_t _slot = 0;
+	size_t _slots = 0;
+};
+
+template<class CharT, class Traits>
+constexpr size_t std::experimental::basic_format_ring<CharT, Traits>::slot_size;
+
+template<class CharT, class Traits>
+std::experimental::basic_format_ring<CharT, Traits>::basic_format_ring(size_t capacity)
+{
+	_slots = 1;
+	while(_slots * slot_size < capacity)
+		_slots *= 2;
+	_data.reset(new CharT[_slots * slot_size]);
+	_states.reset(new atomic<uint64_t>[_slots]);
+	for(size_t i = 0; i < _slots; ++i)
+		_states[i].store(0, memory_order_relaxed);
+}
+
+template<class CharT, class Traits>
+auto std::experimental::basic_format_ring<CharT, Traits>::reserve(size_t n) -> reservation
+{
+	auto slots = n == 0 ? 1 : (n + slot_size - 1) / slot_size;
+	auto tail = _tail.load(memory_order_relaxed);
+	size_t position, skip;
+	do
+	{
+		auto head = _head.load(memory_order_acquire);
+		position = tail & (_slots - 1);
+		// Records are never split, skip the rest of the buffer if it is too short
+		skip = _slots - position < slots ? _slots - position : 0;
+		if(slots > _slots || tail - head + skip + slots > _slots)
+		{
+			_dropped.fetch_add(1, memory_order_relaxed);
+			return { };
+		}
+	}
+	while(!_tail.compare_exchange_weak(tail, tail + skip + slots, memory_order_acq_rel, memory_order_relaxed));
+
+	if(skip > 0)
+	{
+		publish(position, skip, 0, published | padding);
+		position = 0;
+	}
+	return { this, _data.get() + position * slot_size, n, position, slots };
+}
+
+template<class CharT, class Traits>
+template<class F>
+size_t std::experimental::basic_format_ring<CharT, Traits>::consume(F f)
+{
+	size_t count = 0;
+	auto head = _head.load(memory_order_relaxed);
+	while(true)
+	{
+		auto slot = head & (_slots - 1);
+		auto state = _states[slot].load(memory_order_acquire);
+		if((state & published) == 0)
+			break;
+		if((state & padding) == 0)
+		{
+			f(string_view_type{ _data.get() + slot * slot_size, state_length(state) });
+			++count;
+		}
+		// Only the first slot of a record has a state, clearing it leaves all states outside of the reserved records clear
+		_states[slot].store(0, memory_order_relaxed);
+		head += state_slots(state);
+		_head.store(head, memory_order_release);
+	}
+	return count;
+}
+
+template<class CharT, class Traits, class FormatSource, class... Args>
+bool std::experimental::try_format(basic_format_ring<CharT, Traits>& ring, const FormatSource& fmt, const Args&... args)
+{
+	// Determine the size first so the record can be formatted in place
+	auto record = ring.reserve(formatted_size(fmt, args...));
+	if(!record)
+		return false;
+	format(in_place, record, fmt, args...);
+	record.publish();
+	return true;
+}
+
+#endif // std_format_detail_format_ring_hpp
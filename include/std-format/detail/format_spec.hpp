@@ -0,0 +1,176 @@
+//
+//  format_spec.hpp
+//  std-format
+//
+//  Created by knejp on 9.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_spec_hpp
+#define std_format_detail_format_spec_hpp
+
+#include <std-format/detail/format_syntax.hpp>
+#include <std-format/detail/string_view.hpp>
+
+#include <stdexcept>
+
+namespace std { namespace experimental
+{
+	/// Tag type to select the parse_format_flags() overload for \p T.
+	template<class T>
+	struct format_tag { };
+
+	/**
+	 The standard format flags understood by the builtin arithmetic types.
+
+	 The syntax is `[[fill]align][sign][#][0][width][.precision][type]` where
+	 - \p align is one of `<`, `>` or `^` for left, right and center alignment within \p width, optionally preceded by a \p fill character,
+	 - \p sign is `-` (only negative numbers), `+` (always) or a space (a space for positive numbers),
+	 - `#` selects the alternate form of the type,
+	 - `0` pads numbers with zeros between the sign and the digits if no explicit alignment is given,
+	 - \p type is a single character whose meaning depends on the formatted type.
+
+	 User types are free to parse their flags into their own state, see parse_format_flags().
+	 */
+	template<class CharT>
+	struct format_spec
+	{
+		CharT fill = CharT(' ');
+		format_align align = format_align::right;
+		bool explicit_align = false;
+		char sign = '-';
+		bool alternate = false;
+		bool zero = false;
+		int width = 0;
+		int precision = -1; // Negative if not specified
+		char type = 0; // Zero if not specified
+	};
+
+	/// Parse \p flags according to the format_spec syntax. Throws runtime_error if the flags are malformed.
+	/// Usable during constant evaluation, where malformed flags are a compile error.
+	template<class CharT, class Traits>
+	constexpr format_spec<CharT> parse_format_spec(basic_string_view<CharT, Traits> flags);
+
+	/*
+	 Customization point: user types may provide an overload
+	 `State parse_format_flags(format_tag<T>, basic_string_view<CharT, Traits> flags)`
+	 findable by ADL together with `to_string(const T& x, format_appender<Sink>& app, const State& state)`.
+	 The precompiled formatter then parses the flags of every format argument only once during construction and passes the stored state on every invocation.
+	 Types without such an overload keep receiving the flags string.
+	 */
+
+	namespace detail
+	{
+		/// Write the already formatted number in [first, last) with the sign and padding requested by \p spec.
+		/// Zero padding is only applied if \p zero_pad is true, i.e. not for infinity or NaN.
+		/// The first \p prefix characters after the sign are a base prefix like `0x` and are kept in front of the zero padding.
+		template<class CharT, class Appender>
+		size_t write_number(Appender& app, const format_spec<CharT>& spec, const CharT* first, const CharT* last, bool zero_pad = true, size_t prefix = 0);
+		
+		/// Report malformed flags, if errors are collected instead of thrown the defaults are used.
+		template<class CharT>
+		format_spec<CharT> invalid_format_spec(const char* message)
+		{
+			raise_format_error(format_errc::invalid_flags, message);
+			return { };
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+template<class CharT, class Traits>
+constexpr auto std::experimental::parse_format_spec(basic_string_view<CharT, Traits> flags) -> format_spec<CharT>
+{
+	using namespace detail;
+	
+	format_spec<CharT> spec;
+	auto iter = flags.begin();
+	auto last = flags.end();
+	
+	if(iter != last && iter + 1 != last && is_align_char<CharT, Traits>(*(iter + 1)))
+	{
+		spec.fill = *iter;
+		spec.align = to_align<CharT, Traits>(*(iter + 1));
+		spec.explicit_align = true;
+		iter += 2;
+	}
+	else if(iter != last && is_align_char<CharT, Traits>(*iter))
+	{
+		spec.align = to_align<CharT, Traits>(*iter);
+		spec.explicit_align = true;
+		++iter;
+	}
+	if(iter != last && (Traits::eq(*iter, CharT('-')) || Traits::eq(*iter, CharT('+')) || Traits::eq(*iter, CharT(' '))))
+		spec.sign = static_cast<char>(Traits::to_int_type(*iter++));
+	if(iter != last && Traits::eq(*iter, CharT('#')))
+	{
+		spec.alternate = true;
+		++iter;
+	}
+	if(iter != last && Traits::eq(*iter, CharT('0')))
+	{
+		spec.zero = true;
+		++iter;
+	}
+	
+	size_t value = 0;
+	bool negative = false;
+	auto next = scan_integer<CharT, Traits>(iter, last, false, static_cast<size_t>(numeric_limits<int>::max()), value, negative);
+	if(next != iter)
+	{
+		spec.width = static_cast<int>(value);
+		iter = next;
+	}
+	if(iter != last && Traits::eq(*iter, CharT('.')))
+	{
+		value = 0;
+		next = scan_integer<CharT, Traits>(iter + 1, last, false, static_cast<size_t>(numeric_limits<int>::max()), value, negative);
+		if(next == iter + 1)
+			return invalid_format_spec<CharT>("Missing precision in format flags.");
+		spec.precision = static_cast<int>(value);
+		iter = next;
+	}
+	if(iter != last)
+	{
+		auto type = Traits::to_int_type(*iter++);
+		if(type <= 0 || type >= 0x80)
+			return invalid_format_spec<CharT>("Invalid type in format flags.");
+		spec.type = static_cast<char>(type);
+	}
+	if(iter != last)
+		return invalid_format_spec<CharT>("Unexpected trailing characters in format flags.");
+	return spec;
+}
+
+template<class CharT, class Appender>
+size_t std::experimental::detail::write_number(Appender& app, const format_spec<CharT>& spec, const CharT* first, const CharT* last, bool zero_pad, size_t prefix)
+{
+	CharT sign = 0;
+	if(first != last && *first == CharT('-'))
+		sign = *first++;
+	else if(spec.sign != '-')
+		sign = CharT(spec.sign);
+	
+	auto length = static_cast<size_t>(last - first) + (sign ? 1 : 0);
+	auto width = static_cast<size_t>(spec.width);
+	auto padding = length < width ? width - length : 0;
+	if(padding > 0 && spec.zero && !spec.explicit_align && zero_pad)
+	{
+		if(sign)
+			app.append(sign);
+		if(prefix)
+			app.append(first, prefix);
+		app.append(padding, CharT('0'));
+		app.append(first + prefix, last - first - prefix);
+		return width;
+	}
+	
+	auto leading = spec.align == format_align::left ? 0 : spec.align == format_align::center ? padding / 2 : padding;
+	app.append(leading, spec.fill);
+	if(sign)
+		app.append(sign);
+	app.append(first, last - first);
+	app.append(padding - leading, spec.fill);
+	return length + padding;
+}
+
+#endif // std_format_detail_format_spec_hpp
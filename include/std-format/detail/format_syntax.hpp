@@ -0,0 +1,276 @@
+//
+//  format_syntax.hpp
+//  std-format
+//
+//  Created by knejp on 2.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_format_syntax_hpp
+#define std_format_detail_format_syntax_hpp
+
+#include <cstddef>
+#include <limits>
+
+// The syntactic core of the format string grammar.
+// Everything in here is constexpr so it can be shared by the runtime format_parser and the compile-time format literals.
+
+namespace std { namespace experimental
+{
+	enum class format_align : unsigned char
+	{
+		left,
+		right,
+		center,
+	};
+
+	namespace detail
+	{
+		enum class format_syntax_status
+		{
+			ok,
+			invalid_nesting, // Unescaped closing brace outside of a format argument or opening brace inside one
+			unexpected_end, // Format argument not closed before the end of the format string
+			invalid_index, // Missing or malformed index
+			index_out_of_bounds, // Index not less than the number of arguments
+			invalid_width, // Malformed alignment width
+			unexpected_character, // Index/alignment not followed by ':' or '}'
+		};
+
+		/// How a formatted argument is padded to a minimum width.
+		template<class CharT>
+		struct format_alignment
+		{
+			CharT fill;
+			format_align align;
+			int width; // Zero disables padding
+		};
+
+		/// Result of scanning a single format argument starting at its opening brace.
+		template<class CharT, class Iter>
+		struct format_argument_syntax
+		{
+			format_syntax_status status;
+			Iter pos; // Position of the error, or one past the closing brace on success
+			size_t index;
+			format_alignment<CharT> alignment;
+			Iter flags_first;
+			Iter flags_last;
+			bool flags_escaped; // The flags contain escaped braces and must be unescaped before use
+		};
+
+		/// Find the next brace in [first, last) and return its iterator or \p last if none was found.
+		template<class CharT, class Traits, class Iter>
+		constexpr Iter find_brace(Iter first, Iter last)
+		{
+			for( ; first != last; ++first)
+				if(Traits::eq(*first, CharT('{')) || Traits::eq(*first, CharT('}')))
+					return first;
+			return last;
+		}
+
+		/// Check whether the brace at \p brace is escaped by a duplicate of itself.
+		template<class CharT, class Traits, class Iter>
+		constexpr bool is_escaped_brace(Iter brace, Iter last)
+		{
+			return (brace + 1) != last && Traits::eq(*(brace + 1), *brace);
+		}
+
+		/// The brace search used by the grammar below, which must stay usable in constant expressions.
+		/// Runtime callers pass block_brace_search from brace_scanner.hpp instead.
+		struct constexpr_brace_search
+		{
+			template<class CharT, class Traits, class Iter>
+			static constexpr Iter find(Iter first, Iter last) { return find_brace<CharT, Traits>(first, last); }
+		};
+
+		/// Skip all characters until an unescaped brace is encountered and return its iterator or \p last if none was found.
+		template<class CharT, class Traits, class Search = constexpr_brace_search, class Iter>
+		constexpr Iter find_unescaped_brace(Iter first, Iter last)
+		{
+			while(true)
+			{
+				auto brace = Search::template find<CharT, Traits>(first, last);
+				if(brace == last || !is_escaped_brace<CharT, Traits>(brace, last))
+					return brace;
+				first = brace + 2;
+			}
+		}
+
+		template<class CharT, class Traits>
+		constexpr bool is_digit(CharT ch)
+		{
+			return !Traits::lt(ch, CharT('0')) && !Traits::lt(CharT('9'), ch);
+		}
+
+		/// Parse the decimal integer in [first, last) with an optional sign and return the iterator past it.
+		/// \p value is left untouched and \p first returned if no valid integer is found or it exceeds \p max.
+		template<class CharT, class Traits, class Iter>
+		constexpr Iter scan_integer(Iter first, Iter last, bool allow_negative, size_t max, size_t& value, bool& negative)
+		{
+			auto iter = first;
+			negative = false;
+			if(iter != last && (Traits::eq(*iter, CharT('+')) || (allow_negative && Traits::eq(*iter, CharT('-')))))
+			{
+				negative = Traits::eq(*iter, CharT('-'));
+				++iter;
+			}
+			if(iter == last || !is_digit<CharT, Traits>(*iter))
+				return first;
+
+			size_t i = 0;
+			bool overflow = false; // Consume the entire range of valid characters, even on overflow
+			for( ; iter != last && is_digit<CharT, Traits>(*iter); ++iter)
+			{
+				auto digit = static_cast<size_t>(*iter - CharT('0'));
+				overflow |= i > (max - digit) / 10;
+				i = i * 10 + digit;
+			}
+			if(overflow)
+				return first;
+			value = i;
+			return iter;
+		}
+
+		template<class CharT, class Traits>
+		constexpr bool is_align_char(CharT ch)
+		{
+			return Traits::eq(ch, CharT('<')) || Traits::eq(ch, CharT('>')) || Traits::eq(ch, CharT('^'));
+		}
+
+		template<class CharT, class Traits>
+		constexpr format_align to_align(CharT ch)
+		{
+			return Traits::eq(ch, CharT('<')) ? format_align::left : Traits::eq(ch, CharT('>')) ? format_align::right : format_align::center;
+		}
+
+		/// Scan the alignment following the comma of a format argument, either `[fill]<|>|^width` or a plain width where negative values align to the left.
+		/// Returns the iterator past the width and sets \p width_pos to where the width starts, both are equal if the width is malformed.
+		template<class CharT, class Traits, class Iter>
+		constexpr Iter scan_alignment(Iter pos, Iter rbrace, format_alignment<CharT>& alignment, Iter& width_pos)
+		{
+			auto explicit_align = true;
+			if(pos != rbrace && pos + 1 != rbrace && is_align_char<CharT, Traits>(*(pos + 1)))
+			{
+				alignment.fill = *pos;
+				alignment.align = to_align<CharT, Traits>(*(pos + 1));
+				pos += 2;
+			}
+			else if(pos != rbrace && is_align_char<CharT, Traits>(*pos))
+			{
+				alignment.align = to_align<CharT, Traits>(*pos);
+				++pos;
+			}
+			else
+				explicit_align = false;
+
+			width_pos = pos;
+			size_t width = 0;
+			bool negative = false;
+			pos = scan_integer<CharT, Traits>(pos, rbrace, !explicit_align, static_cast<size_t>(numeric_limits<int>::max()), width, negative);
+			alignment.width = static_cast<int>(width);
+			if(!explicit_align)
+				alignment.align = negative ? format_align::left : format_align::right;
+			return pos;
+		}
+
+		/// Scan the format argument whose opening brace is at \p lbrace.
+		template<class CharT, class Traits, class Search = constexpr_brace_search, class Iter>
+		constexpr format_argument_syntax<CharT, Iter> scan_format_argument(Iter lbrace, Iter last, size_t nargs)
+		{
+			format_argument_syntax<CharT, Iter> result{ format_syntax_status::ok, lbrace, 0, { CharT(' '), format_align::right, 0 }, last, last, false };
+			if(!Traits::eq(*lbrace, CharT('{')))
+			{
+				result.status = format_syntax_status::invalid_nesting;
+				return result;
+			}
+
+			auto pos = lbrace + 1;
+			auto rbrace = find_unescaped_brace<CharT, Traits, Search>(pos, last);
+			if(rbrace == last)
+			{
+				result.status = format_syntax_status::unexpected_end;
+				result.pos = rbrace;
+				return result;
+			}
+			if(!Traits::eq(*rbrace, CharT('}')))
+			{
+				result.status = format_syntax_status::invalid_nesting;
+				result.pos = rbrace;
+				return result;
+			}
+
+			bool negative = false;
+			auto next = scan_integer<CharT, Traits>(pos, rbrace, false, numeric_limits<size_t>::max(), result.index, negative);
+			if(next == pos)
+			{
+				result.status = format_syntax_status::invalid_index;
+				result.pos = pos;
+				return result;
+			}
+			pos = next;
+			if(result.index >= nargs)
+			{
+				result.status = format_syntax_status::index_out_of_bounds;
+				result.pos = pos;
+				return result;
+			}
+
+			if(Traits::eq(*pos, CharT(',')))
+			{
+				auto width_pos = pos;
+				next = scan_alignment<CharT, Traits>(pos + 1, rbrace, result.alignment, width_pos);
+				if(next == width_pos)
+				{
+					result.status = format_syntax_status::invalid_width;
+					result.pos = width_pos;
+					return result;
+				}
+				pos = next;
+			}
+
+			if(Traits::eq(*pos, CharT(':')))
+				++pos;
+			else if(!Traits::eq(*pos, CharT('}')))
+			{
+				// If index/align is not followed by a colon it must be closed immediately
+				result.status = format_syntax_status::unexpected_character;
+				result.pos = pos;
+				return result;
+			}
+
+			result.pos = rbrace + 1;
+			result.flags_first = pos;
+			result.flags_last = rbrace;
+			result.flags_escaped = Search::template find<CharT, Traits>(pos, rbrace) != rbrace;
+			return result;
+		}
+
+		/// Scan a format argument which is already known to be valid, e.g. because it was checked during compilation.
+		/// Performs none of the checks of scan_format_argument() and the status is always \p ok.
+		template<class CharT, class Traits, class Search = constexpr_brace_search, class Iter>
+		constexpr format_argument_syntax<CharT, Iter> scan_checked_argument(Iter lbrace, Iter last)
+		{
+			format_argument_syntax<CharT, Iter> result{ format_syntax_status::ok, lbrace, 0, { CharT(' '), format_align::right, 0 }, last, last, false };
+			auto pos = lbrace + 1;
+			for( ; is_digit<CharT, Traits>(*pos); ++pos)
+				result.index = result.index * 10 + static_cast<size_t>(*pos - CharT('0'));
+			if(Traits::eq(*pos, CharT(',')))
+			{
+				auto width_pos = pos;
+				pos = scan_alignment<CharT, Traits>(pos + 1, last, result.alignment, width_pos);
+			}
+			if(Traits::eq(*pos, CharT(':')))
+				++pos;
+
+			auto rbrace = find_unescaped_brace<CharT, Traits, Search>(pos, last);
+			result.pos = rbrace + 1;
+			result.flags_first = pos;
+			result.flags_last = rbrace;
+			result.flags_escaped = Search::template find<CharT, Traits>(pos, rbrace) != rbrace;
+			return result;
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+#endif // std_format_detail_format_syntax_hpp
@@ -15,34 +15,6 @@ namespace std { namespace experimental
 	{
 		template<class CharT, class Traits, class... Args>
 		class immediate_formatter;
-		
-		template<class Args, class Appender, class FmtFlags>
-		using format_signature = function<size_t(const Args&, Appender&, const FmtFlags&)> ;
-		
-		template<class Args, class Appender, class FmtFlags, size_t N>
-		constexpr format_signature<Args, Appender, FmtFlags> make_format_delegate()
-		{
-			return [] (const Args& args, Appender& app, const FmtFlags& flags)
-			{
-				return dispatch_to_string(get<N>(args), app, flags);
-			};
-		}
-		
-		template<class Args, class Appender, class FmtFlags, class I>
-		struct format_delegates;
-		
-		template<class Args, class Appender, class FmtFlags, size_t... I>
-		struct format_delegates<Args, Appender, FmtFlags, integer_sequence<size_t, I...>>
-		{
-			array<format_signature<Args, Appender, FmtFlags>, sizeof...(I)> value
-			{{
-				make_format_delegate<Args, Appender, FmtFlags, I>()...
-			}};
-			constexpr const format_signature<Args, Appender, FmtFlags>& operator[] (size_t n)
-			{
-				return value[n];
-			}
-		};
 	} // namespace detail
 }} // namespace std::experimental
 
@@ -50,8 +22,6 @@ namespace std { namespace experimental
 template<class CharT, class Traits, class... Args>
 class std::experimental::detail::immediate_formatter
 {
-	using Tuple = tuple<const Args&...>;
-
 public:
 	using format_type = basic_string_view<CharT, Traits>;
 	using format_iterator = typename format_type::const_iterator;
@@ -64,58 +34,29 @@ public:
 	template<class Appender>
 	size_t operator() (Appender& app, const Args&... args) const
 	{
-		basic_string<CharT, Traits> temp; // This buffer is used for all temporaries we need, thus hopefully minimizing the number of reallocations
-		
-		format_delegates<Tuple, Appender, format_type, make_index_sequence<sizeof...(Args)>> delegates1;
-		format_delegates<Tuple, decltype(make_format_appender(temp)), format_type, make_index_sequence<sizeof...(Args)>> delegates2;
+		// Arguments are dispatched by index through a static table shared by all calls, nothing needs constructing per call.
+		// Without a place to keep them the flags are parsed every time.
+		using table = argument_table<Appender, CharT, Traits, Args...>;
 		
 		size_t printed = 0;
 		
-		auto values = std::tie(args...);
-		for(auto component : parse_format(_fmt, sizeof...(Args)))
+		typename table::values_type values{ args... };
+		for(const auto& component : parse_format(_fmt, sizeof...(Args)))
 		{
 			if(component.type == format_component_type::static_substring)
 				app.append(component.substring);
 			else if(component.type == format_component_type::format_argument)
 			{
-				if(component.width > 0)
-					printed += right_align(app, component, values, temp, delegates2);
-				else if(component.width < 0)
-					printed += left_align(app, component, values, delegates1);
+				if(component.flags_escaped)
+					printed += table::format_escaped(app, values, component.index, component.substring, component.alignment);
 				else
-					printed += delegates1[component.index](values, app, component.substring);
+					printed += table::value[component.index](app, values, nullptr, 0, component.substring, component.alignment);
 			}
 		}
 		return printed;
 	}
 	
 private:
-	template<class Appender, class Component, class Values, class Delegates>
-	static size_t right_align(Appender& app, Component& component, Values& values, basic_string<CharT, Traits>& temp, Delegates& delegates)
-	{
-		// Format the substring first to determine its length and prepend the padding if necessary.
-		// Padding is done using the space ' ' character.
-		temp.clear();
-		auto app2 = make_format_appender(temp);
-		auto n = delegates[component.index](values, app2, component.substring);
-		for ( ; n < component.width; ++n)
-			app.append(CharT(' '));
-		app.append(temp);
-		return n;
-	}
-	
-	template<class Appender, class Component, class Values, class Delegates>
-	static size_t left_align(Appender& app, Component& component, Values& values, Delegates& delegates)
-	{
-		// Fill the destination directly and append padding if necessary.
-		// Padding is done using the space ' ' character.
-		component.width = -component.width;
-		auto n = delegates[component.index](values, app, component.substring);
-		for ( ; n < component.width; ++n)
-			app.append(CharT(' '));
-		return n;
-	}
-	
 	format_type _fmt;
 };
 
@@ -23,20 +23,20 @@ namespace std { namespace experimental
 		using traits_type = Traits;
 		using value_type = CharT;
 		
-		basic_string_view() : basic_string_view("", "") { }
-		basic_string_view(const value_type* str) : basic_string_view(str, strlen(str)) { }
-		basic_string_view(const value_type* str, size_t len) : _str(str), _len(len) { }
-		basic_string_view(const_iterator begin, const_iterator end) : basic_string_view(begin, end - begin) { }
+		constexpr basic_string_view() : basic_string_view(_empty, size_t(0)) { }
+		basic_string_view(const value_type* str) : basic_string_view(str, Traits::length(str)) { }
+		constexpr basic_string_view(const value_type* str, size_t len) : _str(str), _len(len) { }
+		constexpr basic_string_view(const_iterator begin, const_iterator end) : basic_string_view(begin, end - begin) { }
 		template<class Allocator>
 		basic_string_view(const basic_string<CharT, Traits, Allocator>& str) : basic_string_view(str.data(), str.size()) { }
 		
-		iterator begin() const noexcept { return _str; }
-		iterator end() const noexcept { return _str + _len; }
-		const_iterator cbegin() const noexcept { return _str; }
-		const_iterator cend() const noexcept { return _str + _len; }
+		constexpr iterator begin() const noexcept { return _str; }
+		constexpr iterator end() const noexcept { return _str + _len; }
+		constexpr const_iterator cbegin() const noexcept { return _str; }
+		constexpr const_iterator cend() const noexcept { return _str + _len; }
 		
-		const CharT* data() const noexcept { return _str; }
-		size_t size() const noexcept { return _len; }
+		constexpr const CharT* data() const noexcept { return _str; }
+		constexpr size_t size() const noexcept { return _len; }
 		
 		basic_string_view remove_prefix(size_t n)
 		{
@@ -49,10 +49,15 @@ namespace std { namespace experimental
 		}
 		
 	private:
+		static constexpr CharT _empty[1] = { };
+		
 		const CharT* _str;
 		size_t _len;
 	};
 	
+	template<class CharT, class Traits>
+	constexpr CharT basic_string_view<CharT, Traits>::_empty[1];
+	
 	using string_view = basic_string_view<char>;
 	using wstring_view = basic_string_view<wchar_t>;
 	using u16string_view = basic_string_view<char16_t>;
@@ -12,16 +12,149 @@
 // included from <string.hpp>
 
 #include <std-format/detail/format_appender.hpp>
+#include <std-format/detail/format_spec.hpp>
+#include <std-format/detail/write_float.hpp>
+#include <std-format/detail/write_integer.hpp>
 
 namespace std { namespace experimental
 {
-/*	
-	template<class Sink, class CharT, class Traits>
-	format_appender<Sink> to_string(int i, format_appender<Sink> app, basic_string<CharT, Traits> options)
+	/// Integers accept the format_spec flags without a type or with the types `d` (decimal), `x` or `X` (hexadecimal with lower- or uppercase letters),
+	/// `o` (octal) and `b` (binary). With the `#` flag the digits of the latter are preceded by `0x`, `0X`, `0o` or `0b`, and zero padding goes between prefix and digits.
+	/// Negative numbers are written as a sign followed by the magnitude, not in two's complement. A precision is rejected.
+	template<class Int, class CharT, class Traits>
+	constexpr auto parse_format_flags(format_tag<Int>, basic_string_view<CharT, Traits> flags)
+		-> typename enable_if<detail::is_format_integer<Int>::value, format_spec<CharT>>::type;
+
+	/// Write the decimal, hexadecimal, octal or binary representation of an integer directly to the appender without any temporary strings.
+	/// Accepts all integral types (including the 128 bit extensions if supported) except bool and the character types.
+	template<class Int, class Sink, class CharT>
+	auto to_string(Int i, format_appender<Sink>& app, const format_spec<CharT>& spec)
+		-> typename enable_if<detail::is_format_integer<Int>::value, size_t>::type;
+
+	template<class Int, class Sink, class CharT, class Traits>
+	auto to_string(Int i, format_appender<Sink>& app, basic_string_view<CharT, Traits> flags)
+		-> typename enable_if<detail::is_format_integer<Int>::value, size_t>::type
+	{
+		return to_string(i, app, parse_format_flags(format_tag<Int>(), flags));
+	}
+
+	/// Floating point numbers accept the format_spec flags except `#` with the types `e`, `f`, `g` or their uppercase variants.
+	/// Without a precision the shortest representation that reads back to the same value is printed.
+	template<class Float, class CharT, class Traits>
+	constexpr auto parse_format_flags(format_tag<Float>, basic_string_view<CharT, Traits> flags)
+		-> typename enable_if<is_floating_point<Float>::value, format_spec<CharT>>::type;
+
+	/// Write a floating point number directly to the appender.
+	template<class Float, class Sink, class CharT>
+	auto to_string(Float x, format_appender<Sink>& app, const format_spec<CharT>& spec)
+		-> typename enable_if<is_floating_point<Float>::value, size_t>::type;
+
+	template<class Float, class Sink, class CharT, class Traits>
+	auto to_string(Float x, format_appender<Sink>& app, basic_string_view<CharT, Traits> flags)
+		-> typename enable_if<is_floating_point<Float>::value, size_t>::type
 	{
-		
+		return to_string(x, app, parse_format_flags(format_tag<Float>(), flags));
+	}
+	
+	namespace detail
+	{
+		template<class Int, class Sink, class CharT>
+		size_t write_radix_integer(format_appender<Sink>& app, Int i, const format_spec<CharT>& spec);
 	}
-*/	
 }} // namespace std::experimental
 
+template<class Int, class CharT, class Traits>
+constexpr auto std::experimental::parse_format_flags(format_tag<Int>, basic_string_view<CharT, Traits> flags)
+	-> typename enable_if<detail::is_format_integer<Int>::value, format_spec<CharT>>::type
+{
+	auto spec = parse_format_spec(flags);
+	if(spec.type != 0 && spec.type != 'd' && !detail::is_radix_type(spec.type))
+		return detail::invalid_format_spec<CharT>("Invalid type in format flags of integer.");
+	if(spec.precision >= 0)
+		return detail::invalid_format_spec<CharT>("Precision is not allowed in format flags of integer.");
+	return spec;
+}
+
+template<class Int, class Sink, class CharT>
+auto std::experimental::to_string(Int i, format_appender<Sink>& app, const format_spec<CharT>& spec)
+	-> typename enable_if<detail::is_format_integer<Int>::value, size_t>::type
+{
+	if(detail::is_radix_type(spec.type))
+		return detail::write_radix_integer(app, i, spec);
+	if(spec.width == 0 && spec.sign == '-')
+	{
+		// Write the digits directly to the destination if possible
+		auto d = detail::decompose_integer(i);
+		if(auto out = detail::try_prepare<CharT>(app, d.size))
+		{
+			detail::write_integer(out, d);
+			detail::try_commit(app, d.size);
+			return d.size;
+		}
+	}
+	CharT buffer[detail::max_integer_digits];
+	auto last = detail::write_integer(buffer, i);
+	if(spec.width == 0 && spec.sign == '-')
+	{
+		app.append(buffer, last - buffer);
+		return last - buffer;
+	}
+	return detail::write_number(app, spec, buffer, last);
+}
+
+template<class Int, class Sink, class CharT>
+size_t std::experimental::detail::write_radix_integer(format_appender<Sink>& app, Int i, const format_spec<CharT>& spec)
+{
+	auto r = decompose_radix_integer(i, spec.type, spec.alternate);
+	if(spec.width == 0 && spec.sign == '-')
+	{
+		if(auto out = try_prepare<CharT>(app, r.size))
+		{
+			write_radix_integer(out, r);
+			try_commit(app, r.size);
+			return r.size;
+		}
+	}
+	CharT buffer[max_radix_digits];
+	auto last = write_radix_integer(buffer, r);
+	if(spec.width == 0 && spec.sign == '-')
+	{
+		app.append(buffer, last - buffer);
+		return last - buffer;
+	}
+	return write_number(app, spec, buffer, last, true, r.prefix);
+}
+
+template<class Float, class CharT, class Traits>
+constexpr auto std::experimental::parse_format_flags(format_tag<Float>, basic_string_view<CharT, Traits> flags)
+	-> typename enable_if<is_floating_point<Float>::value, format_spec<CharT>>::type
+{
+	auto spec = parse_format_spec(flags);
+	switch(spec.type)
+	{
+		case 0: case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+			break;
+		default:
+			return detail::invalid_format_spec<CharT>("Invalid type in format flags of floating point number.");
+	}
+	if(spec.alternate)
+		return detail::invalid_format_spec<CharT>("Alternate form is not supported for floating point numbers.");
+	return spec;
+}
+
+template<class Float, class Sink, class CharT>
+auto std::experimental::to_string(Float x, format_appender<Sink>& app, const format_spec<CharT>& spec)
+	-> typename enable_if<is_floating_point<Float>::value, size_t>::type
+{
+	auto fmt = detail::make_float_format(spec.precision, spec.type);
+	if(spec.width == 0 && spec.sign == '-')
+		return detail::write_float<CharT>(app, x, fmt);
+	
+	// Sign and padding can only be applied once the length is known
+	detail::scratch_buffer<CharT, format_appender<Sink>> temp{ detail::scratch_allocator<CharT>(app) };
+	auto app2 = make_format_appender(temp);
+	detail::write_float<CharT>(app2, x, fmt);
+	return detail::write_number(app, spec, temp.data(), temp.data() + temp.size(), isfinite(x));
+}
+
 #endif // std_format_detail_to_string_hpp
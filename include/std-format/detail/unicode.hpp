@@ -0,0 +1,295 @@
+//
+//  unicode.hpp
+//  std-format
+//
+//  Created by knejp on 15.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_unicode_hpp
+#define std_format_detail_unicode_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STD_FORMAT_UNICODE_SSE2
+#endif
+
+// Decoding and encoding of UTF-8, UTF-16 and UTF-32.
+// The encoding of a character type is determined by its size, thus wchar_t is UTF-16 or UTF-32 depending on the platform.
+// Malformed sequences decode to U+FFFD, a sequence cut off by the end of the input is reported separately so it can be completed by the next fragment.
+// Most text is ASCII, so the conversion between char and either char16_t or char32_t copies ASCII runs in blocks of 16 characters (SSE2) without decoding them.
+// This is only an ASCII fast path: every other sequence, and every conversion between char16_t and char32_t, is decoded one code point at a time.
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		/// Returned by the decoders if the input ends in the middle of a sequence. The input iterator is not advanced.
+		constexpr char32_t incomplete_sequence = 0xFFFFFFFF;
+		constexpr char32_t replacement_character = 0xFFFD;
+
+		/// Decode the UTF-8 sequence at \p first and advance \p first past it.
+		/// A malformed sequence is consumed up to the first byte which cannot be part of it.
+		template<class Iter>
+		char32_t decode_utf8(Iter& first, Iter last)
+		{
+			static const char32_t min_code_point[] = { 0, 0x80, 0x800, 0x10000 };
+
+			auto iter = first;
+			auto lead = static_cast<char32_t>(static_cast<unsigned char>(*iter++));
+			size_t trail = lead >= 0xF0 && lead <= 0xF4 ? 3 : lead >= 0xE0 && lead < 0xF0 ? 2 : lead >= 0xC2 && lead < 0xE0 ? 1 : 0;
+			if(lead < 0x80 || trail == 0)
+			{
+				first = iter;
+				return lead < 0x80 ? lead : replacement_character;
+			}
+			auto cp = lead & (0x3Fu >> trail);
+			for(size_t i = 0; i < trail; ++i, ++iter)
+			{
+				if(iter == last)
+					return incomplete_sequence;
+				auto byte = static_cast<char32_t>(static_cast<unsigned char>(*iter));
+				if((byte & 0xC0) != 0x80)
+				{
+					first = iter;
+					return replacement_character;
+				}
+				cp = (cp << 6) | (byte & 0x3F);
+			}
+			first = iter;
+			// Reject overlong encodings, surrogates and values beyond the Unicode range
+			if(cp < min_code_point[trail] || (cp >= 0xD800 && cp < 0xE000) || cp > 0x10FFFF)
+				return replacement_character;
+			return cp;
+		}
+
+		/// Decode the UTF-16 sequence at \p first and advance \p first past it. Unpaired surrogates decode to U+FFFD.
+		template<class Iter>
+		char32_t decode_utf16(Iter& first, Iter last)
+		{
+			auto unit = static_cast<char32_t>(static_cast<uint16_t>(*first));
+			if(unit < 0xD800 || unit >= 0xE000)
+			{
+				++first;
+				return unit;
+			}
+			auto next = first;
+			++next;
+			if(unit >= 0xDC00)
+			{
+				first = next;
+				return replacement_character;
+			}
+			if(next == last)
+				return incomplete_sequence;
+			auto low = static_cast<char32_t>(static_cast<uint16_t>(*next));
+			if(low < 0xDC00 || low >= 0xE000)
+			{
+				first = next;
+				return replacement_character;
+			}
+			first = ++next;
+			return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+		}
+
+		template<class Iter>
+		char32_t decode_utf32(Iter& first, Iter)
+		{
+			auto cp = static_cast<char32_t>(*first++);
+			return (cp >= 0xD800 && cp < 0xE000) || cp > 0x10FFFF ? replacement_character : cp;
+		}
+
+		template<class Iter>
+		char32_t decode_code_point(Iter& first, Iter last, integral_constant<size_t, 1>) { return decode_utf8(first, last); }
+		template<class Iter>
+		char32_t decode_code_point(Iter& first, Iter last, integral_constant<size_t, 2>) { return decode_utf16(first, last); }
+		template<class Iter>
+		char32_t decode_code_point(Iter& first, Iter last, integral_constant<size_t, 4>) { return decode_utf32(first, last); }
+
+		/// Decode the code point at \p first in the encoding of \p CharT and advance \p first past it.
+		template<class CharT, class Iter>
+		char32_t decode_code_point(Iter& first, Iter last) { return decode_code_point(first, last, integral_constant<size_t, sizeof(CharT)>()); }
+
+		template<class CharT>
+		void encode_code_point(char32_t cp, CharT*& out, integral_constant<size_t, 1>)
+		{
+			if(cp < 0x80)
+				*out++ = static_cast<CharT>(cp);
+			else if(cp < 0x800)
+			{
+				*out++ = static_cast<CharT>(0xC0 | (cp >> 6));
+				*out++ = static_cast<CharT>(0x80 | (cp & 0x3F));
+			}
+			else if(cp < 0x10000)
+			{
+				*out++ = static_cast<CharT>(0xE0 | (cp >> 12));
+				*out++ = static_cast<CharT>(0x80 | ((cp >> 6) & 0x3F));
+				*out++ = static_cast<CharT>(0x80 | (cp & 0x3F));
+			}
+			else
+			{
+				*out++ = static_cast<CharT>(0xF0 | (cp >> 18));
+				*out++ = static_cast<CharT>(0x80 | ((cp >> 12) & 0x3F));
+				*out++ = static_cast<CharT>(0x80 | ((cp >> 6) & 0x3F));
+				*out++ = static_cast<CharT>(0x80 | (cp & 0x3F));
+			}
+		}
+
+		template<class CharT>
+		void encode_code_point(char32_t cp, CharT*& out, integral_constant<size_t, 2>)
+		{
+			if(cp < 0x10000)
+				*out++ = static_cast<CharT>(cp);
+			else
+			{
+				*out++ = static_cast<CharT>(0xD800 + ((cp - 0x10000) >> 10));
+				*out++ = static_cast<CharT>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+			}
+		}
+
+		template<class CharT>
+		void encode_code_point(char32_t cp, CharT*& out, integral_constant<size_t, 4>) { *out++ = static_cast<CharT>(cp); }
+
+		/// Write the code point \p cp in the encoding of \p CharT to \p out and advance it.
+		template<class CharT>
+		void encode_code_point(char32_t cp, CharT*& out) { encode_code_point(cp, out, integral_constant<size_t, sizeof(CharT)>()); }
+
+		/// The maximum number of characters of type \p Out a single character of type \p In is transcoded to.
+		/// A malformed byte of UTF-8 and an unpaired surrogate become a three byte U+FFFD in UTF-8.
+		template<class In, class Out>
+		constexpr size_t max_transcoded_length()
+		{
+			return sizeof(Out) == 1 ? (sizeof(In) == 4 ? 4 : 3) : sizeof(Out) == 2 && sizeof(In) == 4 ? 2 : 1;
+		}
+
+		/// Copy the run of ASCII characters at \p first to \p out and return the first character which is not ASCII, or \p last.
+		template<class In, class Out>
+		const In* copy_ascii(const In* first, const In* last, Out*& out)
+		{
+			for( ; first != last && (static_cast<uint32_t>(*first) & ~uint32_t(0x7F)) == 0; ++first)
+				*out++ = static_cast<Out>(*first);
+			return first;
+		}
+
+		inline const char16_t* copy_ascii(const char16_t* first, const char16_t* last, char*& out);
+		inline const char* copy_ascii(const char* first, const char* last, char16_t*& out);
+		inline const char32_t* copy_ascii(const char32_t* first, const char32_t* last, char*& out);
+		inline const char* copy_ascii(const char* first, const char* last, char32_t*& out);
+
+		/// Convert [first, last) from the encoding of \p In to the encoding of \p Out.
+		/// \p out must have room for max_transcoded_length() characters per input character.
+		/// Returns the end of the converted input, which is before \p last if the input ends in the middle of a sequence.
+		template<class In, class Out>
+		const In* transcode(const In* first, const In* last, Out*& out)
+		{
+			while(first != last)
+			{
+				first = copy_ascii(first, last, out);
+				if(first == last)
+					break;
+				auto next = first;
+				auto cp = decode_code_point<In>(next, last);
+				if(cp == incomplete_sequence)
+					break;
+				encode_code_point(cp, out);
+				first = next;
+			}
+			return first;
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+inline const char16_t* std::experimental::detail::copy_ascii(const char16_t* first, const char16_t* last, char*& out)
+{
+#if defined(STD_FORMAT_UNICODE_SSE2)
+	// Narrow 16 characters at once if none of them has any of the bits above the lowest seven set
+	const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+	for( ; last - first >= 16; first += 16, out += 16)
+	{
+		auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 8));
+		auto bits = _mm_and_si128(_mm_or_si128(low, high), non_ascii);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(bits, _mm_setzero_si128())) != 0xFFFF)
+			break;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+	}
+#endif
+	for( ; first != last && *first < 0x80; ++first)
+		*out++ = static_cast<char>(*first);
+	return first;
+}
+
+inline const char* std::experimental::detail::copy_ascii(const char* first, const char* last, char16_t*& out)
+{
+#if defined(STD_FORMAT_UNICODE_SSE2)
+	// Widen 16 characters at once if none of them has the highest bit set
+	const auto zero = _mm_setzero_si128();
+	for( ; last - first >= 16; first += 16, out += 16)
+	{
+		auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		if(_mm_movemask_epi8(block) != 0)
+			break;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(block, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(block, zero));
+	}
+#endif
+	for( ; first != last && static_cast<unsigned char>(*first) < 0x80; ++first)
+		*out++ = static_cast<char16_t>(*first);
+	return first;
+}
+
+inline const char32_t* std::experimental::detail::copy_ascii(const char32_t* first, const char32_t* last, char*& out)
+{
+#if defined(STD_FORMAT_UNICODE_SSE2)
+	// Narrow 16 characters at once if none of them has any of the bits above the lowest seven set
+	const auto non_ascii = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+	for( ; last - first >= 16; first += 16, out += 16)
+	{
+		auto b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		auto b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 4));
+		auto b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 8));
+		auto b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 12));
+		auto bits = _mm_and_si128(_mm_or_si128(_mm_or_si128(b0, b1), _mm_or_si128(b2, b3)), non_ascii);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(bits, _mm_setzero_si128())) != 0xFFFF)
+			break;
+		// All values are below 0x80, so neither pack saturates
+		auto low = _mm_packs_epi32(b0, b1);
+		auto high = _mm_packs_epi32(b2, b3);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+	}
+#endif
+	for( ; first != last && *first < 0x80; ++first)
+		*out++ = static_cast<char>(*first);
+	return first;
+}
+
+inline const char* std::experimental::detail::copy_ascii(const char* first, const char* last, char32_t*& out)
+{
+#if defined(STD_FORMAT_UNICODE_SSE2)
+	// Widen 16 characters at once if none of them has the highest bit set
+	const auto zero = _mm_setzero_si128();
+	for( ; last - first >= 16; first += 16, out += 16)
+	{
+		auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		if(_mm_movemask_epi8(block) != 0)
+			break;
+		auto low = _mm_unpacklo_epi8(block, zero);
+		auto high = _mm_unpackhi_epi8(block, zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_unpackhi_epi16(high, zero));
+	}
+#endif
+	for( ; first != last && static_cast<unsigned char>(*first) < 0x80; ++first)
+		*out++ = static_cast<char32_t>(*first);
+	return first;
+}
+
+#undef STD_FORMAT_UNICODE_SSE2
+
+#endif // std_format_detail_unicode_hpp
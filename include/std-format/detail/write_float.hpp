@@ -0,0 +1,581 @@
+//
+//  write_float.hpp
+//  std-format
+//
+//  Created by knejp on 6.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_write_float_hpp
+#define std_format_detail_write_float_hpp
+
+#include <std-format/detail/write_integer.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// Shortest round-trip formatting is based on the Grisu2 algorithm by Florian Loitsch:
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010.
+// It always produces digits which convert back to the original value, in rare cases not the shortest possible ones.
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		/// The options understood by the floating point formatter.
+		/// Without a precision the shortest representation that converts back to the same value is used.
+		struct float_format
+		{
+			int precision; // Negative for shortest round-trip
+			char type; // 'e', 'f', 'g' or 0 for the default (like 'g' but with shortest digits)
+			bool upper;
+		};
+
+		/// Translate a type character of the format flags, or zero for the default, into the float_format options.
+		inline float_format make_float_format(int precision, char type)
+		{
+			auto upper = type == 'E' || type == 'F' || type == 'G';
+			return { precision, upper ? static_cast<char>(type - 'A' + 'a') : type, upper };
+		}
+
+		template<class CharT, class Appender, class Float>
+		size_t write_float(Appender& app, Float value, float_format fmt);
+
+		/// Collects characters in blocks of \p N and forwards them to the appender.
+		/// If the appender provides prepare() the characters are written to its storage directly, otherwise they are collected in a local buffer.
+		template<class CharT, class Appender, size_t N = 64>
+		class buffered_writer
+		{
+		public:
+			explicit buffered_writer(Appender& app) : _app(app) { }
+			~buffered_writer() { flush(); }
+
+			void put(CharT ch)
+			{
+				if(_size == _capacity)
+					reserve();
+				_out[_size++] = ch;
+			}
+			template<class Char>
+			void put(const Char* str, size_t len)
+			{
+				for(size_t i = 0; i < len; ++i)
+					put(CharT(str[i]));
+			}
+			void put(size_t n, CharT ch)
+			{
+				while(n--)
+					put(ch);
+			}
+			void flush()
+			{
+				if(_out != _buffer && _out != nullptr)
+					try_commit(_app, _size);
+				else if(_size > 0)
+					_app.append(_buffer, _size);
+				_written += _size;
+				_size = 0;
+				_capacity = 0;
+				_out = nullptr;
+			}
+			size_t written() const { return _written + _size; }
+			const Appender& appender() const { return _app; }
+
+		private:
+			void reserve()
+			{
+				flush();
+				_out = try_prepare<CharT>(_app, N);
+				if(!_out)
+					_out = _buffer;
+				_capacity = N;
+			}
+
+			Appender& _app;
+			CharT* _out = nullptr; // Either the window of the appender or _buffer
+			size_t _size = 0;
+			size_t _capacity = 0;
+			size_t _written = 0;
+			CharT _buffer[N];
+		};
+
+		struct diy_fp
+		{
+			uint64_t f;
+			int e;
+
+			static diy_fp sub(diy_fp x, diy_fp y) { return { x.f - y.f, x.e }; }
+
+			// Returns the upper 64 bits of the 128 bit product, rounded
+			static diy_fp mul(diy_fp x, diy_fp y)
+			{
+				auto u_lo = x.f & 0xFFFFFFFFu;
+				auto u_hi = x.f >> 32;
+				auto v_lo = y.f & 0xFFFFFFFFu;
+				auto v_hi = y.f >> 32;
+
+				auto p0 = u_lo * v_lo;
+				auto p1 = u_lo * v_hi;
+				auto p2 = u_hi * v_lo;
+				auto p3 = u_hi * v_hi;
+
+				auto q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu) + (uint64_t(1) << 31);
+				return { p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64 };
+			}
+
+			static diy_fp normalize(diy_fp x)
+			{
+				while((x.f >> 63) == 0)
+				{
+					x.f <<= 1;
+					--x.e;
+				}
+				return x;
+			}
+
+			static diy_fp normalize_to(diy_fp x, int e)
+			{
+				return { x.f << (x.e - e), e };
+			}
+		};
+
+		struct float_boundaries
+		{
+			diy_fp w;
+			diy_fp minus;
+			diy_fp plus;
+		};
+
+		/// Split the positive finite value into its normalized significand and the normalized boundaries of its rounding interval.
+		template<class Float>
+		float_boundaries compute_boundaries(Float value)
+		{
+			constexpr int precision = numeric_limits<Float>::digits;
+			constexpr int bias = numeric_limits<Float>::max_exponent - 1 + (precision - 1);
+			constexpr int min_exponent = 1 - bias;
+			constexpr uint64_t hidden_bit = uint64_t(1) << (precision - 1);
+
+			using bits_type = typename conditional<precision == 24, uint32_t, uint64_t>::type;
+			bits_type bits = 0;
+			memcpy(&bits, &value, sizeof(bits));
+
+			auto e = static_cast<int>(bits >> (precision - 1));
+			auto f = static_cast<uint64_t>(bits & (hidden_bit - 1));
+
+			auto v = e == 0 ? diy_fp{ f, min_exponent } : diy_fp{ f + hidden_bit, e - bias };
+			// The lower boundary is closer if the significand is a power of two (but not for the smallest normalized number)
+			auto lower_closer = f == 0 && e > 1;
+			auto plus = diy_fp{ 2 * v.f + 1, v.e - 1 };
+			auto minus = lower_closer ? diy_fp{ 4 * v.f - 1, v.e - 2 } : diy_fp{ 2 * v.f - 1, v.e - 1 };
+
+			auto w_plus = diy_fp::normalize(plus);
+			return { diy_fp::normalize(v), diy_fp::normalize_to(minus, w_plus.e), w_plus };
+		}
+
+		struct cached_power
+		{
+			uint64_t f;
+			int e;
+			int k;
+		};
+
+		template<class Dummy = void>
+		struct grisu_tables
+		{
+			// Normalized approximations of 10^k for k = -300, -292, ..., 324
+			static constexpr cached_power powers[79] =
+			{
+				{ 0xAB70FE17C79AC6CA, -1060, -300 },
+				{ 0xFF77B1FCBEBCDC4F, -1034, -292 },
+				{ 0xBE5691EF416BD60C, -1007, -284 },
+				{ 0x8DD01FAD907FFC3C,  -980, -276 },
+				{ 0xD3515C2831559A83,  -954, -268 },
+				{ 0x9D71AC8FADA6C9B5,  -927, -260 },
+				{ 0xEA9C227723EE8BCB,  -901, -252 },
+				{ 0xAECC49914078536D,  -874, -244 },
+				{ 0x823C12795DB6CE57,  -847, -236 },
+				{ 0xC21094364DFB5637,  -821, -228 },
+				{ 0x9096EA6F3848984F,  -794, -220 },
+				{ 0xD77485CB25823AC7,  -768, -212 },
+				{ 0xA086CFCD97BF97F4,  -741, -204 },
+				{ 0xEF340A98172AACE5,  -715, -196 },
+				{ 0xB23867FB2A35B28E,  -688, -188 },
+				{ 0x84C8D4DFD2C63F3B,  -661, -180 },
+				{ 0xC5DD44271AD3CDBA,  -635, -172 },
+				{ 0x936B9FCEBB25C996,  -608, -164 },
+				{ 0xDBAC6C247D62A584,  -582, -156 },
+				{ 0xA3AB66580D5FDAF6,  -555, -148 },
+				{ 0xF3E2F893DEC3F126,  -529, -140 },
+				{ 0xB5B5ADA8AAFF80B8,  -502, -132 },
+				{ 0x87625F056C7C4A8B,  -475, -124 },
+				{ 0xC9BCFF6034C13053,  -449, -116 },
+				{ 0x964E858C91BA2655,  -422, -108 },
+				{ 0xDFF9772470297EBD,  -396, -100 },
+				{ 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+				{ 0xF8A95FCF88747D94,  -343,  -84 },
+				{ 0xB94470938FA89BCF,  -316,  -76 },
+				{ 0x8A08F0F8BF0F156B,  -289,  -68 },
+				{ 0xCDB02555653131B6,  -263,  -60 },
+				{ 0x993FE2C6D07B7FAC,  -236,  -52 },
+				{ 0xE45C10C42A2B3B06,  -210,  -44 },
+				{ 0xAA242499697392D3,  -183,  -36 },
+				{ 0xFD87B5F28300CA0E,  -157,  -28 },
+				{ 0xBCE5086492111AEB,  -130,  -20 },
+				{ 0x8CBCCC096F5088CC,  -103,  -12 },
+				{ 0xD1B71758E219652C,   -77,   -4 },
+				{ 0x9C40000000000000,   -50,    4 },
+				{ 0xE8D4A51000000000,   -24,   12 },
+				{ 0xAD78EBC5AC620000,     3,   20 },
+				{ 0x813F3978F8940984,    30,   28 },
+				{ 0xC097CE7BC90715B3,    56,   36 },
+				{ 0x8F7E32CE7BEA5C70,    83,   44 },
+				{ 0xD5D238A4ABE98068,   109,   52 },
+				{ 0x9F4F2726179A2245,   136,   60 },
+				{ 0xED63A231D4C4FB27,   162,   68 },
+				{ 0xB0DE65388CC8ADA8,   189,   76 },
+				{ 0x83C7088E1AAB65DB,   216,   84 },
+				{ 0xC45D1DF942711D9A,   242,   92 },
+				{ 0x924D692CA61BE758,   269,  100 },
+				{ 0xDA01EE641A708DEA,   295,  108 },
+				{ 0xA26DA3999AEF774A,   322,  116 },
+				{ 0xF209787BB47D6B85,   348,  124 },
+				{ 0xB454E4A179DD1877,   375,  132 },
+				{ 0x865B86925B9BC5C2,   402,  140 },
+				{ 0xC83553C5C8965D3D,   428,  148 },
+				{ 0x952AB45CFA97A0B3,   455,  156 },
+				{ 0xDE469FBD99A05FE3,   481,  164 },
+				{ 0xA59BC234DB398C25,   508,  172 },
+				{ 0xF6C69A72A3989F5C,   534,  180 },
+				{ 0xB7DCBF5354E9BECE,   561,  188 },
+				{ 0x88FCF317F22241E2,   588,  196 },
+				{ 0xCC20CE9BD35C78A5,   614,  204 },
+				{ 0x98165AF37B2153DF,   641,  212 },
+				{ 0xE2A0B5DC971F303A,   667,  220 },
+				{ 0xA8D9D1535CE3B396,   694,  228 },
+				{ 0xFB9B7CD9A4A7443C,   720,  236 },
+				{ 0xBB764C4CA7A44410,   747,  244 },
+				{ 0x8BAB8EEFB6409C1A,   774,  252 },
+				{ 0xD01FEF10A657842C,   800,  260 },
+				{ 0x9B10A4E5E9913129,   827,  268 },
+				{ 0xE7109BFBA19C0C9D,   853,  276 },
+				{ 0xAC2820D9623BF429,   880,  284 },
+				{ 0x80444B5E7AA7CF85,   907,  292 },
+				{ 0xBF21E44003ACDD2D,   933,  300 },
+				{ 0x8E679C2F5E44FF8F,   960,  308 },
+				{ 0xD433179D9C8CB841,   986,  316 },
+				{ 0x9E19DB92B4E31BA9,  1013,  324 },
+			};
+		};
+
+		template<class Dummy>
+		constexpr cached_power grisu_tables<Dummy>::powers[79];
+
+		// The binary exponent range of the scaled value so the digits can be generated with 64 bit arithmetic
+		constexpr int grisu_alpha = -60;
+		constexpr int grisu_gamma = -32;
+
+		/// Find the cached power c = f * 2^e such that grisu_alpha <= e + \p e + 64 <= grisu_gamma.
+		inline cached_power get_cached_power(int e)
+		{
+			auto f = grisu_alpha - e - 1;
+			auto k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0); // ceil(f * log10(2))
+			auto index = (300 + k + 7) / 8;
+			return grisu_tables<>::powers[index];
+		}
+
+		/// Number of decimal digits of \p n and the largest power of ten not greater than it.
+		inline int find_largest_pow10(uint32_t n, uint32_t& pow10)
+		{
+			static constexpr uint32_t powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+			auto digits = static_cast<int>(count_digits(n));
+			pow10 = powers[digits - 1];
+			return digits;
+		}
+
+		inline void grisu2_round(char* buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+		{
+			// Move the last digit towards w as long as the result stays within the rounding interval
+			while(rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+			{
+				--buffer[length - 1];
+				rest += ten_k;
+			}
+		}
+
+		inline void grisu2_digit_gen(char* buffer, int& length, int& exponent, diy_fp m_minus, diy_fp w, diy_fp m_plus)
+		{
+			auto delta = diy_fp::sub(m_plus, m_minus).f;
+			auto dist = diy_fp::sub(m_plus, w).f;
+
+			// Split m_plus into an integral part p1 and a fractional part p2 with respect to one = 2^-e
+			auto one = diy_fp{ uint64_t(1) << -m_plus.e, m_plus.e };
+			auto p1 = static_cast<uint32_t>(m_plus.f >> -one.e);
+			auto p2 = m_plus.f & (one.f - 1);
+
+			uint32_t pow10 = 0;
+			auto n = find_largest_pow10(p1, pow10);
+			while(n > 0)
+			{
+				auto d = p1 / pow10;
+				p1 %= pow10;
+				buffer[length++] = static_cast<char>('0' + d);
+				--n;
+				auto rest = (uint64_t(p1) << -one.e) + p2;
+				if(rest <= delta)
+				{
+					exponent += n;
+					grisu2_round(buffer, length, dist, delta, rest, uint64_t(pow10) << -one.e);
+					return;
+				}
+				pow10 /= 10;
+			}
+
+			auto m = 0;
+			while(true)
+			{
+				p2 *= 10;
+				auto d = p2 >> -one.e;
+				p2 &= one.f - 1;
+				buffer[length++] = static_cast<char>('0' + d);
+				++m;
+				delta *= 10;
+				dist *= 10;
+				if(p2 <= delta)
+					break;
+			}
+			exponent -= m;
+			grisu2_round(buffer, length, dist, delta, p2, one.f);
+		}
+
+		/// Generate the shortest digits of the positive finite \p value.
+		/// The value equals digits * 10^exponent.
+		template<class Float>
+		void grisu2(char* buffer, int& length, int& exponent, Float value)
+		{
+			auto b = compute_boundaries(value);
+			auto cached = get_cached_power(b.plus.e);
+			auto c = diy_fp{ cached.f, cached.e };
+
+			auto w = diy_fp::mul(b.w, c);
+			auto w_minus = diy_fp::mul(b.minus, c);
+			auto w_plus = diy_fp::mul(b.plus, c);
+
+			// Shrink the interval by one unit on both ends to account for the imprecision of the multiplication
+			length = 0;
+			exponent = -cached.k;
+			grisu2_digit_gen(buffer, length, exponent, { w_minus.f + 1, w_minus.e }, w, { w_plus.f - 1, w_plus.e });
+		}
+
+		template<class Writer>
+		void write_exponent(Writer& out, int exponent, bool upper)
+		{
+			out.put(upper ? 'E' : 'e');
+			out.put(exponent < 0 ? '-' : '+');
+			if(exponent < 0)
+				exponent = -exponent;
+			if(exponent < 10)
+				out.put('0');
+			char buffer[max_integer_digits];
+			auto last = write_integer(buffer, exponent);
+			out.put(buffer, last - buffer);
+		}
+
+		/// Lay out the digits d1 d2 ... dn * 10^exponent in the requested notation.
+		template<class Writer>
+		void write_shortest(Writer& out, const char* digits, int length, int exponent, char type, bool upper, int max_fixed)
+		{
+			auto point = length + exponent; // Position of the decimal point relative to the first digit
+			if(type == 'e' || (type != 'f' && (point < -3 || point > max_fixed)))
+			{
+				out.put(digits[0]);
+				if(length > 1)
+				{
+					out.put('.');
+					out.put(digits + 1, length - 1);
+				}
+				write_exponent(out, point - 1, upper);
+			}
+			else if(point >= length)
+			{
+				out.put(digits, length);
+				out.put(point - length, '0');
+			}
+			else if(point > 0)
+			{
+				out.put(digits, point);
+				out.put('.');
+				out.put(digits + point, length - point);
+			}
+			else
+			{
+				out.put('0');
+				out.put('.');
+				out.put(-point, '0');
+				out.put(digits, length);
+			}
+		}
+
+		/// Fixed notation with a small precision computed on the integer scaled value.
+		/// Returns false if the result cannot be determined reliably this way and a fallback must be used.
+		template<class Writer>
+		bool write_fixed_scaled(Writer& out, double value, int precision)
+		{
+			static constexpr double scales[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+			static constexpr uint64_t divisors[] = { 1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u,
+				10000000000u, 100000000000u, 1000000000000u, 10000000000000u, 100000000000000u, 1000000000000000u };
+
+			if(precision > 15)
+				return false;
+			auto scaled = value * scales[precision];
+			if(!(scaled < 9007199254740992.0)) // 2^53, everything below is an exact integer
+				return false;
+			auto integer = floor(scaled);
+			auto fraction = scaled - integer;
+			// The multiplication is off by at most half an ulp of the result, rounding is unambiguous if we are farther away from the midpoint
+			if(fabs(fraction - 0.5) <= scaled * numeric_limits<double>::epsilon())
+				return false;
+
+			auto n = static_cast<uint64_t>(integer) + (fraction > 0.5 ? 1 : 0);
+			char buffer[max_integer_digits];
+			auto last = write_integer(buffer, n / divisors[precision]);
+			out.put(buffer, last - buffer);
+			if(precision > 0)
+			{
+				out.put('.');
+				last = write_integer(buffer, n % divisors[precision]);
+				out.put(static_cast<size_t>(precision - (last - buffer)), '0');
+				out.put(buffer, last - buffer);
+			}
+			return true;
+		}
+
+		/// Replace the decimal separator of the current C locale in the output of snprintf() by '.' and return the new length.
+		/// \p str holds the digits of a non-negative finite number, so the separator is whatever follows the integer digits up to the next digit.
+		inline size_t normalize_decimal_point(char* str, size_t n)
+		{
+			auto last = str + n;
+			auto sep = str;
+			while(sep != last && *sep >= '0' && *sep <= '9')
+				++sep;
+			if(sep == last || *sep == '.' || *sep == 'e' || *sep == 'E')
+				return n;
+			auto digits = sep;
+			while(digits != last && (*digits < '0' || *digits > '9'))
+				++digits;
+			*sep = '.';
+			return static_cast<size_t>(copy(digits, last, sep + 1) - str);
+		}
+
+		template<class Float>
+		struct printf_length { static constexpr const char* value = ""; };
+		template<>
+		struct printf_length<long double> { static constexpr const char* value = "L"; };
+
+		/// Fallback for precisions not covered by the specialized paths.
+		template<class Writer, class Float>
+		void write_printf(Writer& out, Float value, int precision, char type, bool upper)
+		{
+			char spec[8] = "%.*";
+			strcat(spec, printf_length<Float>::value);
+			auto len = strlen(spec);
+			spec[len] = upper ? static_cast<char>(type - 'a' + 'A') : type;
+			spec[len + 1] = '\0';
+
+			char buffer[512];
+			auto n = snprintf(buffer, sizeof(buffer), spec, precision, value);
+			if(n < 0)
+				return;
+			// The fast paths always write '.', so the output must not depend on the locale
+			if(static_cast<size_t>(n) < sizeof(buffer))
+				out.put(buffer, normalize_decimal_point(buffer, n));
+			else
+			{
+				// Only huge values in fixed notation or huge precisions end up here
+				scratch_buffer<char, decay_t<decltype(out.appender())>> large{ scratch_allocator<char>(out.appender()) };
+				auto str = large.prepare(n + 1);
+				snprintf(str, n + 1, spec, precision, value);
+				out.put(str, normalize_decimal_point(str, n));
+			}
+		}
+
+		template<class Writer, class Float>
+		void write_float_shortest(Writer& out, Float value, char type, bool upper)
+		{
+			char digits[32];
+			int length = 1;
+			int exponent = 0;
+			if(value == 0)
+				digits[0] = '0';
+			else
+				grisu2(digits, length, exponent, value);
+			write_shortest(out, digits, length, exponent, type, upper, numeric_limits<Float>::max_digits10);
+		}
+
+		template<class Writer>
+		void write_float_shortest(Writer& out, long double value, char type, bool upper)
+		{
+			// Grisu is only implemented for the IEEE single and double precision formats
+			if(static_cast<long double>(static_cast<double>(value)) == value)
+			{
+				write_float_shortest(out, static_cast<double>(value), type, upper);
+				return;
+			}
+			// Otherwise search for the smallest precision that reads back to the same value and lay out its digits ourselves
+			char buffer[64];
+			for(auto precision = numeric_limits<long double>::digits10; ; ++precision)
+			{
+				snprintf(buffer, sizeof(buffer), "%.*Le", precision - 1, value);
+				if(precision == numeric_limits<long double>::max_digits10 || strtold(buffer, nullptr) == value)
+					break;
+			}
+			// The buffer has the form d.ddde[+-]x, with the separator of the current locale
+			char digits[64];
+			int length = 0;
+			auto p = buffer;
+			for( ; *p != 'e'; ++p)
+				if(*p >= '0' && *p <= '9')
+					digits[length++] = *p;
+			auto exponent = atoi(p + 1) - (length - 1);
+			for( ; length > 1 && digits[length - 1] == '0'; --length)
+				++exponent;
+			write_shortest(out, digits, length, exponent, type, upper, numeric_limits<long double>::max_digits10);
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+template<class CharT, class Appender, class Float>
+size_t std::experimental::detail::write_float(Appender& app, Float value, float_format fmt)
+{
+	buffered_writer<CharT, Appender> out{ app };
+	if(isnan(value))
+	{
+		out.put(fmt.upper ? "NAN" : "nan", 3);
+		out.flush();
+		return out.written();
+	}
+	if(signbit(value))
+	{
+		out.put(CharT('-'));
+		value = -value;
+	}
+
+	if(isinf(value))
+		out.put(fmt.upper ? "INF" : "inf", 3);
+	else if(fmt.precision < 0)
+		write_float_shortest(out, value, fmt.type, fmt.upper);
+	else
+	{
+		auto type = fmt.type == 0 ? 'g' : fmt.type;
+		if(type != 'f' || is_same<Float, long double>::value || !write_fixed_scaled(out, static_cast<double>(value), fmt.precision))
+			write_printf(out, value, fmt.precision, type, fmt.upper);
+	}
+	out.flush();
+	return out.written();
+}
+
+#endif // std_format_detail_write_float_hpp
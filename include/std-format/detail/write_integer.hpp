@@ -0,0 +1,338 @@
+//
+//  write_integer.hpp
+//  std-format
+//
+//  Created by knejp on 4.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_detail_write_integer_hpp
+#define std_format_detail_write_integer_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace std { namespace experimental
+{
+	namespace detail
+	{
+		// Integers formatted as numbers, excluding bool and the character types which have their own to_string() overloads.
+		// The 128 bit types are not is_integral in strict mode so they are added explicitly.
+		template<class T>
+		struct is_format_integer : integral_constant<bool, is_integral<T>::value
+			&& !is_same<T, bool>::value && !is_same<T, char>::value && !is_same<T, wchar_t>::value
+			&& !is_same<T, char16_t>::value && !is_same<T, char32_t>::value> { };
+
+		template<class T>
+		struct format_unsigned : make_unsigned<T> { };
+
+#ifdef __SIZEOF_INT128__
+		// __extension__ keeps -Wpedantic quiet about the non-standard types, everything else refers to them through these names
+		__extension__ typedef __int128 int128_type;
+		__extension__ typedef unsigned __int128 uint128_type;
+
+		template<> struct is_format_integer<int128_type> : true_type { };
+		template<> struct is_format_integer<uint128_type> : true_type { };
+		template<> struct format_unsigned<int128_type> { using type = uint128_type; };
+		template<> struct format_unsigned<uint128_type> { using type = uint128_type; };
+#endif
+
+		template<class T>
+		struct is_format_signed : integral_constant<bool, (T(-1) < T(0))> { };
+
+		/// Enough characters for any supported integer in decimal including the sign.
+		constexpr size_t max_integer_digits = 41;
+
+		template<class Dummy = void>
+		struct digit_tables
+		{
+			// Two digits per entry, indexed by 2 * n for n in [0, 100)
+			static constexpr char pairs[201] =
+				"00010203040506070809"
+				"10111213141516171819"
+				"20212223242526272829"
+				"30313233343536373839"
+				"40414243444546474849"
+				"50515253545556575859"
+				"60616263646566676869"
+				"70717273747576777879"
+				"80818283848586878889"
+				"90919293949596979899";
+		};
+
+		template<class Dummy>
+		constexpr char digit_tables<Dummy>::pairs[201];
+
+		/// Number of decimal digits in \p n, testing four digits per iteration.
+		template<class UInt>
+		size_t count_digits(UInt n)
+		{
+			size_t digits = 1;
+			while(true)
+			{
+				if(n < 10u)
+					return digits;
+				if(n < 100u)
+					return digits + 1;
+				if(n < 1000u)
+					return digits + 2;
+				if(n < 10000u)
+					return digits + 3;
+				n /= 10000u;
+				digits += 4;
+			}
+		}
+
+		/// Write the decimal digits of \p n backwards so that the last digit is placed before \p last.
+		/// Returns the position of the first digit.
+		template<class CharT>
+		CharT* write_digits_backwards(CharT* last, uint64_t n)
+		{
+			auto pairs = digit_tables<>::pairs;
+			while(n >= 100)
+			{
+				auto i = static_cast<unsigned>(n % 100) * 2;
+				n /= 100;
+				*--last = CharT(pairs[i + 1]);
+				*--last = CharT(pairs[i]);
+			}
+			if(n < 10)
+				*--last = CharT('0' + n);
+			else
+			{
+				auto i = static_cast<unsigned>(n) * 2;
+				*--last = CharT(pairs[i + 1]);
+				*--last = CharT(pairs[i]);
+			}
+			return last;
+		}
+
+#ifdef __SIZEOF_INT128__
+		template<class CharT>
+		CharT* write_digits_backwards(CharT* last, uint128_type n)
+		{
+			// Peel off 19 digits at a time so the bulk of the work is done in 64 bit arithmetic
+			constexpr uint64_t chunk = 10000000000000000000u;
+			while(n > numeric_limits<uint64_t>::max())
+			{
+				auto low = static_cast<uint64_t>(n % chunk);
+				n /= chunk;
+				auto first = write_digits_backwards(last, low);
+				while(last - first < 19)
+					*--first = CharT('0');
+				last = first;
+			}
+			return write_digits_backwards(last, static_cast<uint64_t>(n));
+		}
+#endif
+
+		template<class UInt>
+		using digits_type = typename conditional<(sizeof(UInt) > sizeof(uint64_t)), UInt, uint64_t>::type;
+
+		/// An integer split into sign and magnitude together with the length of its decimal representation.
+		template<class Int>
+		struct decimal_integer
+		{
+			typename format_unsigned<Int>::type magnitude;
+			bool negative;
+			size_t size; // Including the sign
+		};
+
+		template<class Int>
+		decimal_integer<Int> decompose_integer(Int i)
+		{
+			using UInt = typename format_unsigned<Int>::type;
+			auto negative = is_format_signed<Int>::value && i < Int(0);
+			UInt n = negative ? static_cast<UInt>(UInt(0) - static_cast<UInt>(i)) : static_cast<UInt>(i);
+			return { n, negative, count_digits(n) + (negative ? 1 : 0) };
+		}
+
+		/// Write exactly \p d.size characters of the decimal representation of \p d to \p out.
+		/// Returns the position past the last character written.
+		template<class CharT, class Int>
+		CharT* write_integer(CharT* out, const decimal_integer<Int>& d)
+		{
+			using UInt = typename format_unsigned<Int>::type;
+			auto last = out + d.size;
+			if(d.negative)
+				*out = CharT('-');
+			if(d.magnitude < 10u)
+				*(last - 1) = CharT('0' + d.magnitude);
+			else
+				write_digits_backwards(last, static_cast<digits_type<UInt>>(d.magnitude));
+			return last;
+		}
+
+		/// Write the decimal representation of \p i with a leading '-' if negative to \p out.
+		/// \p out must have room for at least max_integer_digits characters.
+		/// Returns the position past the last character written.
+		template<class CharT, class Int>
+		CharT* write_integer(CharT* out, Int i)
+		{
+			return write_integer(out, decompose_integer(i));
+		}
+
+		/// Enough characters for any supported integer in binary including the sign and a two character prefix.
+		constexpr size_t max_radix_digits = 128 + 3;
+
+		/// Whether \p type selects one of the power of two bases: `x` and `X` for hexadecimal, `o` for octal and `b` for binary.
+		constexpr bool is_radix_type(char type) { return type == 'x' || type == 'X' || type == 'o' || type == 'b'; }
+
+		/// The number of bits per digit of the base selected by \p type.
+		constexpr unsigned radix_shift(char type) { return type == 'b' ? 1 : type == 'o' ? 3 : 4; }
+
+		/// Number of significant bits in \p n, at least one.
+		inline unsigned bit_width(uint64_t n)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, n | 1);
+			return static_cast<unsigned>(index) + 1;
+#else
+			return 64 - static_cast<unsigned>(__builtin_clzll(n | 1));
+#endif
+		}
+
+#ifdef __SIZEOF_INT128__
+		inline unsigned bit_width(uint128_type n)
+		{
+			auto high = static_cast<uint64_t>(n >> 64);
+			return high != 0 ? 64 + bit_width(high) : bit_width(static_cast<uint64_t>(n));
+		}
+#endif
+
+		/// Number of digits of \p n in the base with \p shift bits per digit.
+		template<class UInt>
+		size_t count_radix_digits(UInt n, unsigned shift)
+		{
+			return (bit_width(static_cast<digits_type<UInt>>(n)) + shift - 1) / shift;
+		}
+
+		// The kernels below produce eight digits at once as the bytes of a word, the least significant digit in the lowest byte.
+		// The bits of every digit are spread into a byte of its own with a few shifts and masks and turned into a character with arithmetic,
+		// thus there is neither a branch nor a table lookup per digit.
+
+		inline uint64_t hex_digits8(uint32_t v, bool upper)
+		{
+			uint64_t x = v;
+			x = ((x & 0xFFFF0000u) << 16) | (x & 0x0000FFFFu);
+			x = ((x & 0x0000FF000000FF00u) << 8) | (x & 0x000000FF000000FFu);
+			x = ((x & 0x00F000F000F000F0u) << 4) | (x & 0x000F000F000F000Fu);
+			// Bit 4 of every byte plus six is set for the digits above nine, which are moved up from after '9' to 'a' or 'A'
+			auto letters = ((x + 0x0606060606060606u) >> 4) & 0x0101010101010101u;
+			return x + 0x3030303030303030u + letters * (upper ? 0x07u : 0x27u);
+		}
+
+		inline uint64_t octal_digits8(uint32_t v)
+		{
+			uint64_t x = v & 0xFFFFFFu;
+			x = ((x & 0xFFF000u) << 20) | (x & 0x000FFFu);
+			x = ((x & 0x00000FC000000FC0u) << 10) | (x & 0x0000003F0000003Fu);
+			x = ((x & 0x0038003800380038u) << 5) | (x & 0x0007000700070007u);
+			return x + 0x3030303030303030u;
+		}
+
+		inline uint64_t binary_digits8(uint8_t v)
+		{
+			// Byte k of the product keeps only bit k of v, adding 0x7F carries it into the top bit of the byte
+			auto x = (v * 0x0101010101010101u) & 0x8040201008040201u;
+			return (((x + 0x7F7F7F7F7F7F7F7Fu) >> 7) & 0x0101010101010101u) + 0x3030303030303030u;
+		}
+
+		/// Store the eight digits of \p x to \p out, the most significant first.
+		template<class CharT>
+		void store_digits8(CharT* out, uint64_t x)
+		{
+			for(unsigned i = 0; i < 8; ++i)
+				out[i] = CharT(static_cast<unsigned char>(x >> (56 - 8 * i)));
+		}
+
+		/// Write exactly \p count digits of \p n ending at \p last in groups of eight computed by \p expand from the lowest bits of \p n.
+		template<class CharT, class UInt, class Expand>
+		void write_radix_backwards(CharT* last, size_t count, UInt n, unsigned shift, Expand expand)
+		{
+			for( ; count >= 8; count -= 8, last -= 8)
+			{
+				store_digits8(last - 8, expand(static_cast<uint64_t>(n)));
+				n >>= 8 * shift;
+			}
+			if(count > 0)
+			{
+				CharT group[8];
+				store_digits8(group, expand(static_cast<uint64_t>(n)));
+				copy(group + 8 - count, group + 8, last - count);
+			}
+		}
+
+		/// Write exactly \p count digits of \p n in the base selected by \p type to \p out.
+		template<class CharT, class UInt>
+		void write_radix_digits(CharT* out, UInt value, size_t count, char type)
+		{
+			auto n = static_cast<digits_type<UInt>>(value);
+			auto last = out + count;
+			switch(type)
+			{
+				case 'x':
+					write_radix_backwards(last, count, n, 4, [](uint64_t v) { return hex_digits8(static_cast<uint32_t>(v), false); });
+					break;
+				case 'X':
+					write_radix_backwards(last, count, n, 4, [](uint64_t v) { return hex_digits8(static_cast<uint32_t>(v), true); });
+					break;
+				case 'o':
+					write_radix_backwards(last, count, n, 3, [](uint64_t v) { return octal_digits8(static_cast<uint32_t>(v)); });
+					break;
+				case 'b':
+					write_radix_backwards(last, count, n, 1, [](uint64_t v) { return binary_digits8(static_cast<uint8_t>(v)); });
+					break;
+			}
+		}
+
+		/// An integer split into sign and magnitude together with the length of its representation in a power of two base.
+		template<class Int>
+		struct radix_integer
+		{
+			typename format_unsigned<Int>::type magnitude;
+			bool negative;
+			char type;
+			size_t prefix; // Length of the base prefix, zero or two
+			size_t digits;
+			size_t size; // Including the sign and prefix
+		};
+
+		/// \p type must satisfy is_radix_type(). If \p alternate is true the digits are preceded by `0x`, `0X`, `0o` or `0b`.
+		template<class Int>
+		radix_integer<Int> decompose_radix_integer(Int i, char type, bool alternate)
+		{
+			using UInt = typename format_unsigned<Int>::type;
+			auto negative = is_format_signed<Int>::value && i < Int(0);
+			UInt n = negative ? static_cast<UInt>(UInt(0) - static_cast<UInt>(i)) : static_cast<UInt>(i);
+			auto digits = count_radix_digits(n, radix_shift(type));
+			size_t prefix = alternate ? 2 : 0;
+			return { n, negative, type, prefix, digits, digits + prefix + (negative ? 1 : 0) };
+		}
+
+		/// Write exactly \p r.size characters of the representation of \p r to \p out.
+		/// Returns the position past the last character written.
+		template<class CharT, class Int>
+		CharT* write_radix_integer(CharT* out, const radix_integer<Int>& r)
+		{
+			if(r.negative)
+				*out++ = CharT('-');
+			if(r.prefix)
+			{
+				*out++ = CharT('0');
+				*out++ = CharT(r.type);
+			}
+			write_radix_digits(out, r.magnitude, r.digits, r.type);
+			return out + r.digits;
+		}
+	} // namespace detail
+}} // namespace std::experimental
+
+#endif // std_format_detail_write_integer_hpp
@@ -47,33 +47,85 @@ namespace std { namespace experimental
 	template<class... Args>
 	using u32vformatter = formatter<u32string_view, Args...>;
 	
+	template<class CharT, class... Args>
+	class basic_checked_format;
+	
+	template<class... Args>
+	using checked_format = basic_checked_format<char, Args...>;
+	template<class... Args>
+	using wchecked_format = basic_checked_format<wchar_t, Args...>;
+	template<class... Args>
+	using u16checked_format = basic_checked_format<char16_t, Args...>;
+	template<class... Args>
+	using u32checked_format = basic_checked_format<char32_t, Args...>;
+	
+	struct format_cache_stats
+	{
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+	};
+
+	template<class CharT, class Traits = char_traits<CharT>>
+	class basic_format_cache;
+
+	using format_cache = basic_format_cache<char>;
+	using wformat_cache = basic_format_cache<wchar_t>;
+	using u16format_cache = basic_format_cache<char16_t>;
+	using u32format_cache = basic_format_cache<char32_t>;
+	
+	template<class CharT, class Traits = char_traits<CharT>>
+	class basic_deferred_buffer;
+	
+	using deferred_buffer = basic_deferred_buffer<char>;
+	using wdeferred_buffer = basic_deferred_buffer<wchar_t>;
+	using u16deferred_buffer = basic_deferred_buffer<char16_t>;
+	using u32deferred_buffer = basic_deferred_buffer<char32_t>;
+	
+	template<class CharT, class Traits = char_traits<CharT>>
+	class basic_format_ring;
+	
+	using format_ring = basic_format_ring<char>;
+	using wformat_ring = basic_format_ring<wchar_t>;
+	using u16format_ring = basic_format_ring<char16_t>;
+	using u32format_ring = basic_format_ring<char32_t>;
+	
+	/// Controls how format_all() divides the work.
+	struct format_all_options
+	{
+		size_t threads = 0; ///< Number of threads including the calling one, zero to use all hardware threads
+		size_t chunk_size = 1024; ///< Number of records formatted by a thread at a time
+	};
+	
 	constexpr struct in_place_t { } in_place{};
+	/// Selects the format() overloads which determine the output size with a counting pre-pass and allocate the result exactly once.
+	constexpr struct exact_size_t { } exact_size{};
 	
 	namespace detail
 	{
 		// Unevaluated helper methods
 		template<class T>
 		auto char_type_impl(T) -> typename T::value_type;
-		wchar_t char_type_impl(wchar_t*);
-		char16_t char_type_impl(char16_t*);
-		char32_t char_type_impl(char32_t*);
+		wchar_t char_type_impl(const wchar_t*);
+		char16_t char_type_impl(const char16_t*);
+		char32_t char_type_impl(const char32_t*);
 		char char_type_impl(...);
 		template<class T>
 		using char_type = decltype(detail::char_type_impl(declval<decay_t<T>>()));
 		
 		template<class T>
-		auto traits_type_impl(T, typename T::traits_type* = 0) -> typename T::traits_type;
+		auto traits_type_impl(T, typename T::traits_type*) -> typename T::traits_type;
 		template<class T>
 		auto traits_type_impl(T, ...) -> char_traits<char_type<T>>;
 		template<class T>
-		using traits_type = decltype(detail::traits_type_impl(declval<decay_t<T>>()));
+		using traits_type = decltype(detail::traits_type_impl(declval<decay_t<T>>(), 0));
 		
 		template<class T>
-		auto allocator_type_impl(T, typename T::allocator_type* = 0) -> typename T::allocator_type;
+		auto allocator_type_impl(T, typename T::allocator_type*) -> typename T::allocator_type;
 		template<class T>
 		auto allocator_type_impl(T, ...) -> allocator<char_type<T>>;
 		template<class T>
-		using allocator_type = decltype(detail::allocator_type_impl(declval<decay_t<T>>()));
+		using allocator_type = decltype(detail::allocator_type_impl(declval<decay_t<T>>(), 0));
 		
 		template<class T, class Allocator>
 		using string_type = basic_string<char_type<T>, traits_type<T>, Allocator>;
@@ -106,6 +158,20 @@ namespace std { namespace experimental
 	template<class... Args, class CharT>
 	bool validate_format(const CharT* fmt, nothrow_t) noexcept { return validate_format<Args...>(basic_string_view<CharT>{fmt}, nothrow); }
 	
+	/// Returns the position of the brace opening the first malformed argument in \p fmt and sets \p ec accordingly, or clears \p ec and returns the size of \p fmt if it is valid.
+	/// Never throws, neither do the other non-throwing overloads which are implemented in terms of this one.
+	template<class CharT, class Traits>
+	size_t validate_format(basic_string_view<CharT, Traits> fmt, size_t nargs, error_code& ec) noexcept;
+	
+	template<class... Args, class CharT, class Traits>
+	size_t validate_format(basic_string_view<CharT, Traits> fmt, error_code& ec) noexcept { return validate_format(fmt, sizeof...(Args), ec); }
+	
+	template<class CharT>
+	size_t validate_format(const CharT* fmt, size_t nargs, error_code& ec) noexcept { return validate_format(basic_string_view<CharT>{fmt}, nargs, ec); }
+	
+	template<class... Args, class CharT>
+	size_t validate_format(const CharT* fmt, error_code& ec) noexcept { return validate_format<Args...>(basic_string_view<CharT>{fmt}, ec); }
+	
 	//@}
 	/// \name Main format method
 	//@{
@@ -133,6 +199,87 @@ namespace std { namespace experimental
 	template<class Destination, class FormatSource, class... Args>
 	size_t format(in_place_t, Destination& dest, const FormatSource& fmt, const Args&... args);
 
+	template<class Result, class FormatSource, class... Args>
+	auto format(exact_size_t, const FormatSource& fmt, const Args&... args) -> Result;
+	
+	template<class FormatSource, class... Args>
+	auto format(exact_size_t, const FormatSource& fmt, const Args&... args)
+		-> detail::string_type<FormatSource, detail::allocator_type<FormatSource>>
+	{
+		return format<detail::string_type<FormatSource, detail::allocator_type<FormatSource>>>(exact_size, fmt, args...);
+	}
+	
+	template<class Result, class Allocator, class FormatSource, class... Args>
+	auto format(exact_size_t, allocator_arg_t, const Allocator& alloc, const FormatSource& fmt, const Args&... args) -> Result;
+	
+	template<class Allocator, class FormatSource, class... Args>
+	auto format(exact_size_t, allocator_arg_t, const Allocator& alloc, const FormatSource& fmt, const Args&... args)
+		-> detail::string_type<FormatSource, Allocator>
+	{
+		return format<detail::string_type<FormatSource, Allocator>>(exact_size, allocator_arg, alloc, fmt, args...);
+	}
+	
+	//@}
+	/// \name Non-throwing format methods
+	/// Errors in the format string, in the flags of the builtin types and while writing to the destination are reported through \p ec instead of throwing.
+	/// Formatting stops at the first malformed format argument, output not fitting into a fixed size destination is truncated.
+	/// The in_place overload returns the number of characters actually written.
+	/// Exceptions thrown by user code and allocators are passed on.
+	//@{
+	
+	template<class Result, class FormatSource, class... Args>
+	auto format(error_code& ec, const FormatSource& fmt, const Args&... args) -> Result;
+	
+	template<class FormatSource, class... Args>
+	auto format(error_code& ec, const FormatSource& fmt, const Args&... args)
+		-> detail::string_type<FormatSource, detail::allocator_type<FormatSource>>
+	{
+		return format<detail::string_type<FormatSource, detail::allocator_type<FormatSource>>>(ec, fmt, args...);
+	}
+	
+	template<class Destination, class FormatSource, class... Args>
+	size_t format(error_code& ec, in_place_t, Destination& dest, const FormatSource& fmt, const Args&... args);
+	
+	//@}
+	/// \name Output size
+	//@{
+	
+	/// The number of characters format() would produce for the given arguments, without writing them anywhere.
+	template<class FormatSource, class... Args>
+	size_t formatted_size(const FormatSource& fmt, const Args&... args);
+	
+	//@}
+	/// \name Deferred formatting
+	//@{
+	
+	/// Capture the arguments in \p buffer to be formatted later by basic_deferred_buffer::consume().
+	/// Returns \p false and drops the record if \p buffer is full.
+	template<class CharT, class Traits, class FormatSource, class... Args>
+	bool deferred_format(basic_deferred_buffer<CharT, Traits>& buffer, const FormatSource& fmt, const Args&... args);
+	
+	//@}
+	/// \name Shared ring buffer
+	//@{
+	
+	/// Format directly into a record reserved in \p ring and publish it. Safe to call from multiple threads concurrently.
+	/// Returns \p false and drops the record if \p ring is full.
+	template<class CharT, class Traits, class FormatSource, class... Args>
+	bool try_format(basic_format_ring<CharT, Traits>& ring, const FormatSource& fmt, const Args&... args);
+	
+	//@}
+	/// \name Bulk formatting
+	//@{
+	
+	/// Format every tuple of arguments in [\p first, \p last) with \p fmt and concatenate the results in order.
+	/// The records are formatted in parallel, \p fmt is parsed only once and shared by all threads.
+	template<class FormatSource, class Iter>
+	auto format_all(const FormatSource& fmt, Iter first, Iter last, format_all_options opts = { })
+		-> detail::string_type<FormatSource, detail::allocator_type<FormatSource>>;
+	
+	/// Same as above but appends the result to \p dest and returns the number of characters written.
+	template<class Destination, class FormatSource, class Iter>
+	size_t format_all(in_place_t, Destination& dest, const FormatSource& fmt, Iter first, Iter last, format_all_options opts = { });
+	
 	//@}
 }} // namespace std::experimental
 
@@ -141,8 +288,16 @@ namespace std { namespace experimental
 
 // Require previous declarations of public names.
 #include <std-format/detail/format_parser.hpp>
+#include <std-format/detail/display_width.hpp>
+#include <std-format/detail/format_argument.hpp>
 #include <std-format/detail/immediate_formatter.hpp>
-//#include <std-format/detail/formatter.hpp> // Currently disabled until the inline format case is mature enough and has a more or less stable implementation and interface
+#include <std-format/detail/format_literal.hpp>
+#include <std-format/detail/checked_format.hpp>
+#include <std-format/detail/formatter.hpp>
+#include <std-format/detail/format_cache.hpp>
+#include <std-format/detail/deferred_format.hpp>
+#include <std-format/detail/format_ring.hpp>
+#include <std-format/detail/format_all.hpp>
 
 namespace std { namespace experimental
 {
@@ -151,18 +306,29 @@ namespace std { namespace experimental
 		using std::begin;
 		using std::end;
 		
+		// Format sources which know how to format themselves (i.e. formatter, basic_format_literal) are preferred by the int/long ranking
 		template<class Appender, class FormatSource, class... Args>
-		auto format_impl(Appender&& app, const FormatSource& fmt, const Args&... args)
+		auto format_impl(int, Appender&& app, const FormatSource& fmt, const Args&... args)
 			-> decltype(fmt(app, args...))
 		{
 			return fmt(app, args...);
 		}
 		template<class Appender, class FormatSource, class... Args>
-		size_t format_impl(Appender&& app, const FormatSource& fmt, const Args&... args)
+		size_t format_impl(long, Appender&& app, const FormatSource& fmt, const Args&... args)
 		{
 			using CharT = detail::char_type<FormatSource>;
 			using Traits = detail::traits_type<FormatSource>;
 			
+			auto& cache = basic_format_cache<CharT, Traits>::local();
+			if(cache.capacity() > 0)
+			{
+				// Keep references in case formatting an argument evicts the entry
+				basic_string_view<CharT, Traits> view{fmt};
+				auto parsed = cache.template lookup_parsed<Args...>(view);
+				using table = argument_table<typename decay<Appender>::type, CharT, Traits, Args...>;
+				return (*parsed.first)(app, table::value, typename table::values_type{ args... }, parsed.second.get());
+			}
+			
 			detail::immediate_formatter<CharT, Traits, Args...> formatter{fmt};
 			return formatter(app, args...);
 		}
@@ -188,7 +354,53 @@ auto std::experimental::format(allocator_arg_t, const Allocator& alloc, const Fo
 template<class Destination, class FormatSource, class... Args>
 size_t std::experimental::format(in_place_t, Destination& dest, const FormatSource& fmt, const Args&... args)
 {
-	return detail::format_impl(make_format_appender(dest), fmt, args...);
+	detail::format_throw_scope scope;
+	return detail::format_impl(0, make_format_appender(dest), fmt, args...);
+}
+
+template<class Result, class FormatSource, class... Args>
+auto std::experimental::format(error_code& ec, const FormatSource& fmt, const Args&... args) -> Result
+{
+	Result out;
+	format(ec, in_place, out, fmt, args...);
+	return out;
+}
+
+template<class Destination, class FormatSource, class... Args>
+size_t std::experimental::format(error_code& ec, in_place_t, Destination& dest, const FormatSource& fmt, const Args&... args)
+{
+	detail::format_error_scope scope;
+	auto app = make_format_appender(dest);
+	detail::format_impl(0, app, fmt, args...);
+	ec = scope.error();
+	// The sum of the formatted lengths includes whatever was cut off by an error, only the appender knows what actually arrived
+	return app.write_count();
+}
+
+template<class Result, class FormatSource, class... Args>
+auto std::experimental::format(exact_size_t, const FormatSource& fmt, const Args&... args) -> Result
+{
+	using Allocator = detail::allocator_type<FormatSource>;
+	return format<Result>(exact_size, allocator_arg, Allocator{}, fmt, args...);
+}
+
+template<class Result, class Allocator, class FormatSource, class... Args>
+auto std::experimental::format(exact_size_t, allocator_arg_t, const Allocator& alloc, const FormatSource& fmt, const Args&... args) -> Result
+{
+	Result out{alloc};
+	out.reserve(formatted_size(fmt, args...));
+	format(in_place, out, fmt, args...);
+	return out;
+}
+
+template<class FormatSource, class... Args>
+size_t std::experimental::formatted_size(const FormatSource& fmt, const Args&... args)
+{
+	detail::format_throw_scope scope;
+	detail::counting_sink<detail::char_type<FormatSource>> sink;
+	auto app = make_format_appender(sink);
+	detail::format_impl(0, app, fmt, args...);
+	return app.write_count();
 }
 
 template<class CharT, class Traits>
@@ -196,6 +408,7 @@ void std::experimental::validate_format(basic_string_view<CharT, Traits> fmt, si
 {
 	// All we do here is let the parser do it's job.
 	// If it doesn't throw the format string doesn't violate any syntactic rules and all indices are valid.
+	detail::format_throw_scope scope;
 	for(auto part : parse_format<CharT, Traits>(fmt, nargs))
 		;
 }
@@ -203,9 +416,21 @@ void std::experimental::validate_format(basic_string_view<CharT, Traits> fmt, si
 template<class CharT, class Traits>
 bool std::experimental::validate_format(basic_string_view<CharT, Traits> fmt, size_t nargs, nothrow_t) noexcept
 {
-	try { validate_format(fmt, nargs); }
-	catch(...) { return false; }
-	return true;
+	error_code ec;
+	validate_format(fmt, nargs, ec);
+	return !ec;
+}
+
+template<class CharT, class Traits>
+size_t std::experimental::validate_format(basic_string_view<CharT, Traits> fmt, size_t nargs, error_code& ec) noexcept
+{
+	// The parser stops at the first error if they are collected, nothing is allocated or thrown
+	detail::format_error_scope scope;
+	auto parser = parse_format<CharT, Traits>(fmt, nargs);
+	for(auto iter = parser.begin(); iter != parser.end(); ++iter)
+		;
+	ec = scope.error();
+	return ec ? scope.position() : fmt.size();
 }
 
 #endif // std_format_format_hpp
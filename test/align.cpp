@@ -0,0 +1,56 @@
+//
+//  align.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <streambuf>
+#include "allocations.hpp"
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	// Writes into a fixed array without allocating
+	struct array_buf : streambuf
+	{
+		char data[2048];
+		array_buf() { reset(); }
+		void reset() { setp(data, data + sizeof(data)); }
+		string str() const { return string(pbase(), pptr()); }
+	};
+}
+
+int main()
+{
+	CHECK_EQUAL(format("[{0,5}]", 42), string("[   42]"));
+	CHECK_EQUAL(format("[{0,-5}]", 42), string("[42   ]"));
+	CHECK_EQUAL(format("[{0,2}]", 12345), string("[12345]"));
+	CHECK(format(L"[{0,4}]", 1.5) == L"[ 1.5]");
+
+	// Right-aligned values formatted into a streambuf go through a temporary on the stack
+	array_buf buf;
+	auto before = test::allocations();
+	for(int i = 0; i < 100; ++i)
+	{
+		buf.reset();
+		format(in_place, buf, "[{0,8}|{1,10:.3f}|{2,6}]", i, 2.5, string_view("ab"));
+	}
+	CHECK_EQUAL(test::allocations(), before);
+	CHECK_EQUAL(buf.str(), string("[      99|     2.500|    ab]"));
+
+	// Values longer than the stack buffer still come out whole
+	auto long_value = string(1000, 'y');
+	buf.reset();
+	format(in_place, buf, "[{0,1005}]", string_view(long_value.data(), 300));
+	CHECK_EQUAL(buf.str(), "[" + string(705, ' ') + string(300, 'y') + "]");
+	CHECK_EQUAL(format("[{0,5}]", long_value), "[" + long_value + "]");
+	CHECK_EQUAL(format("[{0,1005}]", long_value), "[     " + long_value + "]");
+
+	return test::result();
+}
@@ -0,0 +1,59 @@
+//
+//  align_in_place.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <deque>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+int main()
+{
+	// Strings keep what they contained before, the value is shifted within the new part only
+	string s = "abc";
+	format(in_place, s, "{0,6}|{1,-3}|{2,4}", string("xy"), 5, 1.5);
+	CHECK_EQUAL(s, string("abc    xy|5  | 1.5"));
+
+	vector<char> v(12, '.');
+	format(in_place, v, "[{0,5}]{1,3}", 42, 1234);
+	CHECK_EQUAL(string(v.begin(), v.end()), string("[   42]1234."));
+
+	array<char, 10> a;
+	a.fill('.');
+	format(in_place, a, "{0,4}{1,5}", 'x', string_view("yz"));
+	CHECK_EQUAL(string(a.begin(), a.end()), string("   x   yz."));
+
+	deque<char> d(8, '.');
+	format(in_place, d, "{0,7}", -12);
+	CHECK_EQUAL(string(d.begin(), d.end()), string("    -12."));
+
+	// Sinks without random access go through a temporary
+	list<char> l(8, '.');
+	format(in_place, l, "[{0,5}]", 7);
+	CHECK_EQUAL(string(l.begin(), l.end()), string("[    7]."));
+	ostringstream os;
+	format(in_place, os, "[{0,5}]", 3.5);
+	CHECK_EQUAL(os.str(), string("[  3.5]"));
+
+	// Long values are shifted whole
+	auto long_value = string(1000, 'y');
+	vector<char> big(1010);
+	format(in_place, big, "{0,1005}|", long_value);
+	CHECK_EQUAL(string(big.begin(), big.begin() + 1006), string(5, ' ') + long_value + "|");
+
+	array<wchar_t, 3> small{};
+	CHECK_THROWS(format(in_place, small, L"{0,4}", 1), runtime_error);
+
+	return test::result();
+}
@@ -0,0 +1,49 @@
+//
+//  allocations.hpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_test_allocations_hpp
+#define std_format_test_allocations_hpp
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions to count how often a test uses the heap.
+// The replacements are not inline, so only one translation unit of a test may include this header.
+// All forms share malloc() and free() and are kept out of line, so the compiler never pairs a visible malloc() with a delete expression.
+
+#if defined(_MSC_VER)
+#	define STD_FORMAT_TEST_NOINLINE __declspec(noinline)
+#else
+#	define STD_FORMAT_TEST_NOINLINE __attribute__((noinline))
+#endif
+
+namespace test
+{
+	/// Number of calls to the global operator new and operator new[] so far.
+	inline std::size_t& allocations()
+	{
+		static std::size_t count = 0;
+		return count;
+	}
+}
+
+STD_FORMAT_TEST_NOINLINE void* operator new(std::size_t n)
+{
+	++test::allocations();
+	if(auto p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc{};
+}
+STD_FORMAT_TEST_NOINLINE void* operator new[](std::size_t n) { return operator new(n); }
+STD_FORMAT_TEST_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+STD_FORMAT_TEST_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+STD_FORMAT_TEST_NOINLINE void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+STD_FORMAT_TEST_NOINLINE void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif // std_format_test_allocations_hpp
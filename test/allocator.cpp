@@ -0,0 +1,91 @@
+//
+//  allocator.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include "allocations.hpp"
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	size_t arena_allocations = 0;
+
+	template<class T>
+	struct arena
+	{
+		using value_type = T;
+
+		arena() = default;
+		template<class U>
+		arena(const arena<U>&) { }
+
+		T* allocate(size_t n)
+		{
+			++arena_allocations;
+			if(auto p = malloc(n * sizeof(T)))
+				return static_cast<T*>(p);
+			throw bad_alloc{};
+		}
+		void deallocate(T* p, size_t) { free(p); }
+	};
+	template<class T, class U>
+	bool operator==(const arena<T>&, const arena<U>&) { return true; }
+	template<class T, class U>
+	bool operator!=(const arena<T>&, const arena<U>&) { return false; }
+}
+
+namespace app
+{
+	template<class Alloc>
+	using rebound_string = basic_string<char, char_traits<char>, typename allocator_traits<Alloc>::template rebind_alloc<char>>;
+
+	struct name { const char* s; };
+
+	// Preferred over a plain overload because it takes the allocator of the destination
+	template<class Alloc>
+	rebound_string<Alloc> to_string(const name& n, allocator_arg_t, const Alloc& alloc)
+	{
+		rebound_string<Alloc> s(alloc);
+		s.append(n.s);
+		s.append(200, '!');
+		return s;
+	}
+
+	struct plain { };
+	string to_string(const plain&) { return "plain"; }
+}
+
+int main()
+{
+	using arena_string = basic_string<char, char_traits<char>, arena<char>>;
+
+	// Padding, huge floating point values, escaped flags and strings returned by to_string() all use the arena
+	auto before = test::allocations();
+	auto s = format(allocator_arg, arena<char>{}, "{0,400:.300f} {1} {2:a{{x}}b} {3:.600f}", 1.5, 42, app::name{ "bob" }, 1e300);
+	CHECK_EQUAL(test::allocations(), before);
+	CHECK(arena_allocations > 0);
+	CHECK_EQUAL(s.size(), size_t(400 + 1 + 2 + 1 + 203 + 1 + 301 + 1 + 600));
+	CHECK_EQUAL(string(s.begin() + 400, s.begin() + 411), string(" 42 bob!!!!"));
+
+	arena_string in_place_string;
+	before = test::allocations();
+	format(in_place, in_place_string, "{0,-300}|{1:.3f}", app::name{ "x" }, 2.0);
+	CHECK_EQUAL(test::allocations(), before);
+	CHECK_EQUAL(in_place_string.size(), size_t(306));
+
+	// Plain overloads returning std::string still work
+	auto t = format("{0} {1,10}", app::plain{ }, app::name{ "x" });
+	CHECK_EQUAL(t, "plain x" + string(200, '!'));
+
+	return test::result();
+}
@@ -0,0 +1,41 @@
+//
+//  basic.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <sstream>
+#include <stdexcept>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+int main()
+{
+	CHECK_EQUAL(format("a{0}b{{c}}{1,5}|{1,-5}|{2}", 42, string("hi"), 7), string("a42b{c}   hi|hi   |7"));
+	CHECK_EQUAL(format(""), string());
+	CHECK_EQUAL(format("{1}{0}{1}", 1, 2), string("212"));
+
+	string out = "x";
+	format(in_place, out, "{0}-{1}", 1, string_view("y"));
+	CHECK_EQUAL(out, string("x1-y"));
+
+	ostringstream os;
+	format(in_place, os, "{0} {1}", 2, string("stream"));
+	CHECK_EQUAL(os.str(), string("2 stream"));
+
+	CHECK(format(L"{0}", 5) == L"5");
+
+	CHECK(validate_format("{0}", 1, nothrow));
+	CHECK(!validate_format("{0", 1, nothrow));
+	CHECK(!validate_format("{1}", 1, nothrow));
+	CHECK(!validate_format("}", 1, nothrow));
+	CHECK_THROWS(format("{1}", 1), runtime_error);
+	CHECK_THROWS(format("{0,x}", 1), runtime_error);
+
+	return test::result();
+}
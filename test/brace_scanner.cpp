@@ -0,0 +1,97 @@
+//
+//  brace_scanner.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <random>
+#include <string>
+#include "check.hpp"
+
+// Built once for every code path of scan_brace() available on the target: AVX2, SSE2 and the portable SWAR loop.
+// The block scan must find the same brace as the scalar find_brace() wherever it is located relative to the block boundaries.
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	void check_scan(const string& str, size_t offset)
+	{
+		auto first = str.data() + offset;
+		auto last = str.data() + str.size();
+		auto expected = detail::find_brace<char, char_traits<char>>(first, last);
+		auto found = detail::scan_brace<char, char_traits<char>>(first, last);
+		if(found != expected)
+		{
+			test::fail(__FILE__, __LINE__, "scan_brace() == find_brace()");
+			fprintf(stderr, "  length %zu, offset %zu, expected %td, found %td\n", str.size(), offset, expected - first, found - first);
+		}
+	}
+}
+
+int main()
+{
+	// Every position of a single brace in and around one to three 32 character blocks, at several alignments.
+	// The filler contains characters differing from the braces in a single bit to catch false positives.
+	const char filler[] = "zysk[;\xFB\x7F|um]=\xFD";
+	for(size_t length = 0; length <= 100; ++length)
+	{
+		for(size_t offset = 0; offset < 4 && offset <= length; ++offset)
+		{
+			string str(length, 'x');
+			for(size_t i = 0; i < length; ++i)
+				str[i] = filler[i % (sizeof(filler) - 1)];
+			check_scan(str, offset);
+			for(auto brace : { '{', '}' })
+			{
+				for(size_t pos = offset; pos < length; ++pos)
+				{
+					auto copy = str;
+					copy[pos] = brace;
+					check_scan(copy, offset);
+					// A second brace after the first one must not be found first
+					if(pos + 9 < length)
+					{
+						copy[pos + 9] = brace == '{' ? '}' : '{';
+						check_scan(copy, offset);
+					}
+				}
+			}
+		}
+	}
+
+	// Random strings with sparse braces and arbitrary bytes
+	mt19937 rng(3);
+	for(int i = 0; i < 100000; ++i)
+	{
+		string str(rng() % 100, 'a');
+		for(auto& c : str)
+		{
+			auto r = rng() % 40;
+			c = r == 0 ? '{' : r == 1 ? '}' : static_cast<char>(rng() % 256);
+		}
+		check_scan(str, min<size_t>(rng() % 4, str.size()));
+	}
+
+	// The scanner is used when parsing
+	auto text = string(70, 'a');
+	CHECK_EQUAL(format((text + "{0}" + text + "{{").c_str(), 1), text + "1" + text + "{");
+
+	// And for long flags, which are searched for their closing brace and unescaped at runtime
+	auto flags = text + "{{" + text + "}}" + text;
+	auto arg = "{0:" + flags + "}x";
+	auto scanned = detail::scan_format_argument<char, char_traits<char>, detail::block_brace_search>(arg.data(), arg.data() + arg.size(), 1);
+	CHECK(scanned.status == detail::format_syntax_status::ok);
+	CHECK(scanned.flags_escaped);
+	CHECK_EQUAL(string(scanned.flags_first, scanned.flags_last), flags);
+	CHECK_EQUAL(*scanned.pos, 'x');
+	string unescaped;
+	detail::for_each_unescaped(string_view{ flags.data(), flags.size() }, [&](string_view chunk) { unescaped.append(chunk.data(), chunk.size()); });
+	CHECK_EQUAL(unescaped, text + "{" + text + "}" + text);
+
+	return test::result();
+}
@@ -0,0 +1,59 @@
+//
+//  check.hpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#ifndef std_format_test_check_hpp
+#define std_format_test_check_hpp
+
+#include <cstdio>
+#include <string>
+
+// A minimal set of checks for the tests, every failure is reported with its location and the test continues.
+// main() returns test::result() so CTest sees the failures in the exit status.
+
+namespace test
+{
+	inline int& failures()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline void fail(const char* file, int line, const char* expr)
+	{
+		++failures();
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+	}
+
+	inline void print_value(const std::string& value) { std::fprintf(stderr, "  \"%s\"\n", value.c_str()); }
+	template<class T>
+	void print_value(const T&) { }
+
+	template<class A, class B>
+	void check_equal(const A& a, const B& b, const char* file, int line, const char* expr)
+	{
+		if(a == b)
+			return;
+		fail(file, line, expr);
+		print_value(a);
+		print_value(b);
+	}
+
+	inline int result()
+	{
+		if(failures() > 0)
+			std::fprintf(stderr, "%d check(s) failed\n", failures());
+		return failures() > 0 ? 1 : 0;
+	}
+} // namespace test
+
+#define CHECK(expr) ((expr) ? void() : ::test::fail(__FILE__, __LINE__, #expr))
+#define CHECK_EQUAL(a, b) ::test::check_equal((a), (b), __FILE__, __LINE__, #a " == " #b)
+#define CHECK_THROWS(expr, exception) \
+	do { bool thrown = false; try { expr; } catch(const exception&) { thrown = true; } if(!thrown) ::test::fail(__FILE__, __LINE__, #expr " throws " #exception); } while(false)
+
+#endif // std_format_test_check_hpp
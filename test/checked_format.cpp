@@ -0,0 +1,80 @@
+//
+//  checked_format.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+// Only constant arrays are accepted
+static_assert(is_constructible<checked_format<int>, const char(&)[4]>::value, "string literals must be accepted");
+static_assert(!is_constructible<checked_format<int>, char(&)[4]>::value, "mutable arrays must be rejected");
+
+namespace app
+{
+	struct echo { };
+
+	template<class Sink, class CharT, class Traits>
+	size_t to_string(const echo&, format_appender<Sink>& app, basic_string_view<CharT, Traits> flags)
+	{
+		app.append(flags);
+		return flags.size();
+	}
+}
+
+int main()
+{
+	static constexpr checked_format<int, string> f1{"a{0,5}b{1:}c{{}}{0:+}"};
+	CHECK_EQUAL(format(f1, 42, string("xy")), string("a   42bxyc{}+42"));
+	static constexpr checked_format<double, int> f2{"{0:.2f}|{1,*<4:x>+4}|{1,-5}|"};
+	CHECK_EQUAL(format(f2, 3.14159, 7), string("3.14|xx+7|7    |"));
+	static constexpr checked_format<app::echo> f3{"[{0:a{{b}}c}]"};
+	CHECK_EQUAL(format(f3, app::echo{ }), string("[a{b}c]"));
+	static constexpr checked_format<int> f4{"{0}"_fmt};
+	CHECK_EQUAL(format(f4, 5), string("5"));
+	static constexpr wchecked_format<int> f5{L"<{0,^5}>"};
+	CHECK(format(f5, 5) == L"<  5  >");
+	CHECK_EQUAL(format(checked_format<>{"plain"}), string("plain"));
+
+	// Braces beyond the first scanner block
+	static constexpr checked_format<int> f6{"0123456789abcdef0123456789abcdef0123456789{0}{{0123456789abcdef}}{0}"};
+	CHECK_EQUAL(format(f6, 1), string("0123456789abcdef0123456789abcdef01234567891{0123456789abcdef}1"));
+
+	string out;
+	format(in_place, out, f1, 1, string("z"));
+	CHECK_EQUAL(out, string("a    1bzc{}+1"));
+	CHECK_EQUAL(formatted_size(f2, 1.0, 2), format(f2, 1.0, 2).size());
+	error_code ec;
+	CHECK_EQUAL(format(ec, f1, 3, string("w")), string("a    3bwc{}+3"));
+	CHECK(!ec);
+	vector<tuple<int, string>> records{ make_tuple(1, "a"), make_tuple(2, "b") };
+	CHECK_EQUAL(format_all(f1, records.begin(), records.end()), string("a    1bac{}+1a    2bbc{}+2"));
+
+	// Constructed outside of a constant expression the string is checked at runtime
+	CHECK_THROWS(checked_format<int>{"{1}"}, runtime_error);
+	CHECK_THROWS(checked_format<int>{"{0:q}"}, runtime_error);
+	CHECK_THROWS(checked_format<int>{"{0:.2}"}, runtime_error);
+	CHECK_THROWS(checked_format<double>{"{0:#}"}, runtime_error);
+	checked_format<string> user_flags{"{0:q}"};
+	CHECK_EQUAL(format(user_flags, string("s")), string("s"));
+
+	static const char terminated[4] = { '{', '0', '}', 0 };
+	checked_format<int> from_array{terminated};
+	CHECK_EQUAL(format(from_array, 3), string("3"));
+	static const char unterminated[3] = { '{', '0', '}' };
+	CHECK_THROWS(checked_format<int>{unterminated}, runtime_error);
+
+	return test::result();
+}
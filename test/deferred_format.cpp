@@ -0,0 +1,142 @@
+//
+//  deferred_format.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+namespace app
+{
+	struct pod { int a; double b; };
+
+	template<class Sink, class CharT, class Traits>
+	size_t to_string(const pod& p, format_appender<Sink>& out, basic_string_view<CharT, Traits>)
+	{
+		auto s = format("<{0},{1}>", p.a, p.b);
+		out.append(s);
+		return s.size();
+	}
+
+	// Not trivially copyable, captured as a string
+	struct user { string name; vector<int> ids; };
+	string capture_format_argument(const user& u) { return u.name + "#" + std::to_string(u.ids.size()); }
+}
+
+namespace
+{
+	template<class Buffer>
+	vector<string> consume_all(Buffer& buf)
+	{
+		vector<string> lines;
+		buf.consume([&](string_view line) { lines.emplace_back(line.data(), line.size()); });
+		return lines;
+	}
+}
+
+int main()
+{
+	deferred_buffer buf(256);
+	CHECK_EQUAL(buf.capacity(), size_t(256));
+	CHECK(buf.empty());
+
+	// Arguments are captured at the call, not when consumed
+	string s = "hello";
+	CHECK(deferred_format(buf, "{0} {1} {2,6:.2f} {3}|{4}|{5}", 42, s, 3.14159, app::pod{ 1, 0.5 }, app::user{ "bob", { 1, 2, 3 } }, "ptr"));
+	s = "changed";
+	CHECK(deferred_format(buf, "{0}{1}"_fmt, 7, 'x'));
+	CHECK(!buf.empty());
+	auto lines = consume_all(buf);
+	CHECK_EQUAL(lines.size(), size_t(2));
+	if(lines.size() == 2)
+	{
+		CHECK_EQUAL(lines[0], string("42 hello   3.14 <1,0.5>|bob#3|ptr"));
+		CHECK_EQUAL(lines[1], string("7x"));
+	}
+	CHECK(buf.empty());
+
+	// Records are dropped when the buffer is full and the buffer wraps around
+	int accepted = 0;
+	for(int i = 0; i < 100; ++i)
+		accepted += deferred_format(buf, "{0}", string(40, static_cast<char>('a' + i % 26)));
+	CHECK(accepted < 100);
+	CHECK_EQUAL(buf.dropped(), size_t(100 - accepted));
+	CHECK_EQUAL(consume_all(buf).size(), size_t(accepted));
+	for(int round = 0; round < 50; ++round)
+	{
+		CHECK(deferred_format(buf, "r{0}:{1}", round, string(round, 'z')));
+		lines = consume_all(buf);
+		CHECK_EQUAL(lines.size(), size_t(1));
+		if(lines.size() == 1)
+			CHECK_EQUAL(lines[0], "r" + std::to_string(round) + ":" + string(round, 'z'));
+	}
+	CHECK(!deferred_format(buf, "{0}", string(1000, 'q')));
+
+	// Errors surface on the consumer and the record is discarded
+	CHECK(deferred_format(buf, "{1}", 1));
+	CHECK(deferred_format(buf, "{0}", 2));
+	CHECK_THROWS(buf.consume([](string_view) { }), runtime_error);
+	lines = consume_all(buf);
+	CHECK_EQUAL(lines.size(), size_t(1));
+	if(lines.size() == 1)
+		CHECK_EQUAL(lines[0], string("2"));
+
+	wdeferred_buffer wbuf(1024);
+	deferred_format(wbuf, L"{0}-{1}", wstring(L"w"), 5);
+	wstring wline;
+	wbuf.consume([&](wstring_view line) { wline.assign(line.data(), line.size()); });
+	CHECK(wline == L"w-5");
+
+	// Several producers, each with its own buffer, and one consumer draining all of them concurrently.
+	// The records of every producer arrive complete and in the order they were written.
+	const int producers = 4;
+	const int total = 20000;
+	vector<unique_ptr<deferred_buffer>> buffers;
+	for(int i = 0; i < producers; ++i)
+		buffers.emplace_back(new deferred_buffer(4096));
+	vector<thread> threads;
+	for(int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&, p] {
+			for(int i = 0; i < total; )
+			{
+				if(deferred_format(*buffers[p], "{0}:{1} {2}", p, i, string(i % 17, 'k')))
+					++i;
+				else
+					this_thread::yield();
+			}
+		});
+	}
+	vector<int> next(producers, 0);
+	int mismatches = 0;
+	for(int done = 0; done < producers * total; )
+	{
+		for(int p = 0; p < producers; ++p)
+		{
+			done += static_cast<int>(buffers[p]->consume([&](string_view line) {
+				auto want = std::to_string(p) + ":" + std::to_string(next[p]) + " " + string(next[p] % 17, 'k');
+				mismatches += want != string(line.data(), line.size());
+				++next[p];
+			}));
+		}
+	}
+	for(auto& t : threads)
+		t.join();
+	CHECK_EQUAL(mismatches, 0);
+	for(int p = 0; p < producers; ++p)
+		CHECK_EQUAL(next[p], total);
+
+	return test::result();
+}
@@ -0,0 +1,49 @@
+//
+//  dispatch.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace app
+{
+	struct plain { int value; };
+	string to_string(const plain& x) { return "plain" + std::to_string(x.value); }
+
+	struct flagged { int value; };
+	string to_string(const flagged& x) { return "ignored" + std::to_string(x.value); }
+	string to_string(const flagged& x, string_view flags) { return string(flags.data(), flags.size()) + std::to_string(x.value); }
+
+	struct direct { int value; };
+	template<class Sink, class CharT, class Traits>
+	size_t to_string(const direct& x, format_appender<Sink>& app, basic_string_view<CharT, Traits> flags)
+	{
+		auto s = "<" + std::to_string(x.value) + ":" + string(flags.begin(), flags.end()) + ">";
+		app.append(s);
+		return s.size();
+	}
+}
+
+int main()
+{
+	CHECK_EQUAL(format("{0}", app::plain{ 1 }), string("plain1"));
+	CHECK_EQUAL(format("{0,8}|{0,-8}|", app::plain{ 2 }), string("  plain2|plain2  |"));
+
+	// The overloads taking flags take precedence
+	CHECK_EQUAL(format("{0:x=}", app::flagged{ 3 }), string("x=3"));
+	CHECK_EQUAL(format("{0}", app::flagged{ 4 }), string("4"));
+	CHECK_EQUAL(format("{0:ab{{}}}", app::direct{ 5 }), string("<5:ab{}>"));
+
+	// Every argument goes to its own entry in the table regardless of the order of use
+	CHECK_EQUAL(format("{9}{8}{7}{6}{5}{4}{3}{2}{1}{0}", 0, 1u, 2l, 3.5, 'c', string("s"), string_view("v"), app::plain{ 7 }, app::flagged{ 8 }, app::direct{ 9 }),
+				string("<9:>8plain7vsc3.5210"));
+
+	return test::result();
+}
@@ -0,0 +1,70 @@
+//
+//  display_width.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <deque>
+#include <sstream>
+#include <string>
+#include "check.hpp"
+
+// Also built with STD_FORMAT_EAST_ASIAN_WIDTH defined to 1.
+
+using namespace std;
+using namespace std::experimental;
+
+int main()
+{
+	const string s = "h\xC3\xA9llo"; // 5 code points in 6 bytes
+	CHECK_EQUAL(format("[{0,8}]", s), "[   " + s + "]");
+	CHECK_EQUAL(format("[{0,-8}]", s), "[" + s + "   ]");
+	CHECK_EQUAL(format("[{0,*^8}]", s), "[*" + s + "**]");
+	CHECK_EQUAL(format("[{0,3}]", s), "[" + s + "]");
+	CHECK_EQUAL(formatted_size("{0,8}", s), size_t(9));
+
+	// Padded in place and through a temporary, both report the padded length
+	string str;
+	CHECK_EQUAL(format(in_place, str, "{0,8}", s), size_t(9));
+	CHECK_EQUAL(str, "   " + s);
+	ostringstream os;
+	CHECK_EQUAL(format(in_place, os, "{0,8}", s), size_t(9));
+	CHECK_EQUAL(os.str(), "   " + s);
+	format(in_place, os, "[{0,-7}|{0,7}]", s);
+	CHECK_EQUAL(os.str(), "   " + s + "[" + s + "  |  " + s + "]");
+
+	array<char, 32> buf{};
+	format(in_place, buf, "{0,-7}|", s);
+	CHECK_EQUAL(string(buf.data(), buf.data() + 9), s + "  |");
+	deque<char> dq(20);
+	format(in_place, dq, "{0,7}", s);
+	CHECK_EQUAL(string(dq.begin(), dq.begin() + 8), "  " + s);
+
+	// Non-ASCII characters inside and after a long ASCII run
+	const string mixed = string(40, 'a') + "\xE2\x82\xAC" + string(20, 'b') + "\xF0\x9F\x98\x80";
+	CHECK_EQUAL(format("{0,70}", mixed).size(), mixed.size() + 70 - 62 - STD_FORMAT_EAST_ASIAN_WIDTH);
+
+	// Malformed UTF-8 counts one column per byte
+	CHECK_EQUAL(format("{0,4}", string("\xFF\xFE")), string("  \xFF\xFE"));
+
+	CHECK(format(u"{0,5}", u16string(u"\xD83D\xDE00x")) == u16string(STD_FORMAT_EAST_ASIAN_WIDTH ? u"  \xD83D\xDE00x" : u"   \xD83D\xDE00x"));
+	CHECK(format(U"{0,-4}|", u32string(U"é")) == U"é   |");
+
+	// Numbers are not affected
+	CHECK_EQUAL(format("{0,6}|{1,-6}|{0,^6}", 42, 1.5), string("    42|1.5   |  42  "));
+
+#if STD_FORMAT_EAST_ASIAN_WIDTH
+	const string cjk = "\xE6\x97\xA5\xE6\x9C\xAC"; // Two wide characters
+	CHECK_EQUAL(format("[{0,6}]", cjk), "[  " + cjk + "]");
+	const string combining = "e\xCC\x81"; // e and a combining acute accent in one column
+	CHECK_EQUAL(format("[{0,3}]", combining), "[  " + combining + "]");
+	CHECK(format(u"{0,3}", u16string(u"\x65E5")) == u" \x65E5");
+	CHECK(format(U"{0,3}", u32string(U"\U0001F600")) == U" \U0001F600");
+#endif
+
+	return test::result();
+}
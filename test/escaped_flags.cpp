@@ -0,0 +1,70 @@
+//
+//  escaped_flags.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <vector>
+#include "allocations.hpp"
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace app
+{
+	// Prints its flags in brackets
+	struct echo { };
+
+	template<class Sink>
+	size_t to_string(const echo&, format_appender<Sink>& app, string_view flags)
+	{
+		app.append('[');
+		app.append(flags);
+		app.append(']');
+		return flags.size() + 2;
+	}
+}
+
+int main()
+{
+	const char* fmt = "{0:{{\"a\": 1}}} x {0:b}}c} {0,8:{{}}}";
+	const string expected = "[{\"a\": 1}] x [b}c]     [{}]";
+
+	// Parsing and unescaping allocates nothing
+	detail::small_buffer<char> out;
+	auto before = test::allocations();
+	format(in_place, out, fmt, app::echo{ });
+	CHECK_EQUAL(test::allocations(), before);
+	CHECK_EQUAL(string(out.data(), out.size()), expected);
+
+	// Flags longer than the scratch buffer
+	auto long_flags = string(300, 'f');
+	CHECK_EQUAL(format(("{0:" + long_flags + "{{}}}").c_str(), app::echo{ }), "[" + long_flags + "{}]");
+
+	// The same result through a formatter and the cache, which unescape once
+	formatter<string_view, app::echo> f{fmt};
+	CHECK_EQUAL(f(app::echo{ }), expected);
+	format_cache::local().set_capacity(4);
+	CHECK_EQUAL(format(fmt, app::echo{ }), expected);
+	CHECK_EQUAL(format(fmt, app::echo{ }), expected);
+	format_cache::local().set_capacity(0);
+
+	// Components refer to the format string and stay valid while the parser moves on
+	vector<format_component<char, char_traits<char>>> parts;
+	for(auto c : parse_format(string_view{fmt}, 1))
+		parts.push_back(c);
+	CHECK_EQUAL(parts.size(), size_t(5));
+	if(!parts.empty())
+	{
+		string flags;
+		detail::for_each_unescaped(parts[0].substring, [&](string_view chunk) { flags.append(chunk.data(), chunk.size()); });
+		CHECK(parts[0].flags_escaped);
+		CHECK_EQUAL(flags, string("{\"a\": 1}"));
+	}
+
+	return test::result();
+}
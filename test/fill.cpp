@@ -0,0 +1,53 @@
+//
+//  fill.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <list>
+#include <sstream>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+int main()
+{
+	CHECK_EQUAL(format("[{0,*^10}]", string("mid")), string("[***mid****]"));
+	CHECK_EQUAL(format("[{0,^6}]", 42), string("[  42  ]"));
+	CHECK_EQUAL(format("[{0,0>5}]", 42), string("[00042]"));
+	CHECK_EQUAL(format("[{0,-<5}]", 42), string("[42---]"));
+	CHECK_EQUAL(format("[{0,>5}|{0,<5}]", 'c'), string("[    c|c    ]"));
+	CHECK_EQUAL(format("[{0,5}|{0,-5}]", 1), string("[    1|1    ]"));
+	CHECK_EQUAL(format("[{0,x^2}]", string("long")), string("[long]"));
+
+	// The same alignment in every kind of format source and destination
+	sformatter<int> f{"[{0,#^7}]"};
+	CHECK_EQUAL(f(-1), string("[##-1###]"));
+	CHECK_EQUAL(format("[{0,#^7}]"_fmt, -1), string("[##-1###]"));
+
+	ostringstream os;
+	format(in_place, os, "[{0,=^100}]", 1);
+	CHECK_EQUAL(os.str(), "[" + string(49, '=') + "1" + string(50, '=') + "]");
+
+	array<char, 8> a;
+	a.fill('.');
+	format(in_place, a, "{0,_^6}", 7);
+	CHECK_EQUAL(string(a.begin(), a.end()), string("__7___.."));
+
+	list<char> l(5, '.');
+	format(in_place, l, "{0,+<4}", 7);
+	CHECK_EQUAL(string(l.begin(), l.end()), string("7+++."));
+
+	CHECK(format(L"{0,*^5}", 1) == L"**1**");
+
+	CHECK(!validate_format("{0,*}", 1, nothrow));
+	CHECK(!validate_format("{0,^}", 1, nothrow));
+
+	return test::result();
+}
@@ -0,0 +1,88 @@
+//
+//  float.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	string printf_string(const char* fmt, int precision, double value)
+	{
+		char buffer[512];
+		snprintf(buffer, sizeof(buffer), fmt, precision, value);
+		return buffer;
+	}
+}
+
+int main()
+{
+	CHECK_EQUAL(format("{0}", 1.0), string("1"));
+	CHECK_EQUAL(format("{0}", 0.1), string("0.1"));
+	CHECK_EQUAL(format("{0}", -0.0), string("-0"));
+	CHECK_EQUAL(format("{0}", 1e21), string("1e+21"));
+	CHECK_EQUAL(format("{0}", 1e-5), string("1e-05"));
+	CHECK_EQUAL(format("{0}", 123.456), string("123.456"));
+	CHECK_EQUAL(format("{0}", 0.1f), string("0.1"));
+	CHECK_EQUAL(format("{0}", 5e-324), string("5e-324"));
+	CHECK_EQUAL(format("{0}", 1.7976931348623157e308), string("1.7976931348623157e+308"));
+	CHECK_EQUAL(format("{0:E}", 1234.5), string("1.2345E+03"));
+	CHECK_EQUAL(format("{0:f}", 1e22), string("10000000000000000000000"));
+	CHECK_EQUAL(format("{0,8:.2f}", 3.14159), string("    3.14"));
+	CHECK_EQUAL(format("{0}", numeric_limits<double>::infinity()), string("inf"));
+	CHECK_EQUAL(format("{0:E}", -numeric_limits<double>::infinity()), string("-INF"));
+	CHECK_EQUAL(format("{0}", numeric_limits<double>::quiet_NaN()), string("nan"));
+	CHECK_EQUAL(format("{0}", 0.1L), string("0.1"));
+	CHECK_EQUAL(format("{0:.3f}", 0.5L), string("0.500"));
+	CHECK(format(L"{0}", 2.25) == L"2.25");
+	CHECK_THROWS(format("{0:#}", 1.5), runtime_error);
+	CHECK_THROWS(format("{0:x}", 1.5), runtime_error);
+
+	mt19937_64 rng(42);
+	for(int i = 0; i < 100000; ++i)
+	{
+		// The shortest representation converts back to the same value
+		uint64_t bits = rng();
+		double d;
+		memcpy(&d, &bits, sizeof(d));
+		if(isfinite(d))
+		{
+			auto s = format("{0}", d);
+			CHECK(strtod(s.c_str(), nullptr) == d);
+			CHECK_EQUAL(format("{0:.12e}", d), printf_string("%.*e", 12, d));
+		}
+		float f;
+		uint32_t fbits = static_cast<uint32_t>(bits);
+		memcpy(&f, &fbits, sizeof(f));
+		if(isfinite(f))
+		{
+			auto s = format("{0}", f);
+			CHECK(strtof(s.c_str(), nullptr) == f);
+		}
+
+		// An explicit precision prints the same digits as printf
+		double value = static_cast<double>(static_cast<int64_t>(rng() % 2000000000)) / static_cast<double>(1 + rng() % 100000);
+		if(rng() & 1)
+			value = -value;
+		int precision = static_cast<int>(rng() % 12);
+		auto precision_flags = std::to_string(precision);
+		CHECK_EQUAL(format(("{0:." + precision_flags + "f}").c_str(), value), printf_string("%.*f", precision, value));
+		CHECK_EQUAL(format(("{0:." + precision_flags + "e}").c_str(), value), printf_string("%.*e", precision, value));
+	}
+
+	return test::result();
+}
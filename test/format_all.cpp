@@ -0,0 +1,116 @@
+//
+//  format_all.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+namespace app
+{
+	// Throws from one of the worker threads
+	struct faulty { int v; };
+
+	string to_string(const faulty& x)
+	{
+		if(x.v == 5000)
+			throw logic_error("faulty");
+		return std::to_string(x.v);
+	}
+
+	// Counts the threads it is formatted on, a new thread starts with a fresh thread_local flag even if it reuses an old id
+	atomic<int> threads_seen{0};
+
+	struct where { };
+
+	string to_string(const where&)
+	{
+		static thread_local bool seen = false;
+		if(!seen)
+		{
+			seen = true;
+			++threads_seen;
+		}
+		// Slow enough that every worker gets a chunk
+		this_thread::sleep_for(chrono::milliseconds(1));
+		return "w";
+	}
+
+	// Formats records with format_all() of its own, possibly on a worker of the pool
+	struct nested { int v; };
+
+	string to_string(const nested& x)
+	{
+		vector<tuple<int>> inner(50, make_tuple(x.v));
+		return format_all("{0}", inner.begin(), inner.end(), { 4, 1 }).substr(0, 1);
+	}
+}
+
+int main()
+{
+	// Later calls reuse the workers started by the first one
+	vector<tuple<app::where>> places(100);
+	for(int i = 0; i < 5; ++i)
+		CHECK_EQUAL(format_all("{0}", places.begin(), places.end(), { 4, 1 }), string(100, 'w'));
+	CHECK(app::threads_seen <= 4);
+
+	// Calls nested inside a worker do not wait for the workers busy with the outer call
+	vector<tuple<app::nested>> outer;
+	for(int i = 0; i < 100; ++i)
+		outer.emplace_back(app::nested{ i % 10 });
+	string digits;
+	for(int i = 0; i < 100; ++i)
+		digits += std::to_string(i % 10);
+	CHECK_EQUAL(format_all("{0}", outer.begin(), outer.end(), { 8, 1 }), digits);
+
+	vector<tuple<int, string, double>> rows;
+	string expected;
+	for(int i = 0; i < 10007; ++i)
+	{
+		rows.emplace_back(i, string(i % 7, static_cast<char>('a' + i % 26)), i * 0.5);
+		expected += format("{0},{1},{2}\n", i, get<1>(rows.back()), i * 0.5);
+	}
+
+	// The chunks are joined in their original order for any number of threads and chunk size
+	CHECK_EQUAL(format_all("{0},{1},{2}\n", rows.begin(), rows.end()), expected);
+	CHECK_EQUAL(format_all("{0},{1},{2}\n", rows.begin(), rows.end(), { 3, 100 }), expected);
+	CHECK_EQUAL(format_all("{0},{1},{2}\n", rows.begin(), rows.end(), { 1, 1 }), expected);
+	CHECK_EQUAL(format_all("{0},{1},{2}\n", rows.begin(), rows.end(), { 64, 1 }), expected);
+	CHECK_EQUAL(format_all("{0},{1},{2}\n"_fmt, rows.begin(), rows.end(), { 4, 333 }), expected);
+	sformatter<int, string, double> f{"{0},{1},{2}\n"};
+	CHECK_EQUAL(format_all(f, rows.begin(), rows.end()), expected);
+	CHECK_EQUAL(format_all("{0}", rows.begin(), rows.begin()), string());
+
+	list<pair<int, int>> pairs{ { 1, 2 }, { 3, 4 }, { 5, 6 } };
+	CHECK(format_all(L"{1}{0};", pairs.begin(), pairs.end(), { 2, 1 }) == L"21;43;65;");
+	ostringstream os;
+	CHECK_EQUAL(format_all(in_place, os, "{0}|", pairs.begin(), pairs.end()), size_t(6));
+	CHECK_EQUAL(os.str(), string("1|3|5|"));
+	string out = "x";
+	format_all(in_place, out, "{0}", pairs.begin(), pairs.end());
+	CHECK_EQUAL(out, string("x135"));
+
+	// Errors in the format string and exceptions of the workers reach the caller
+	CHECK_THROWS(format_all("{5}", pairs.begin(), pairs.end()), runtime_error);
+	vector<tuple<app::faulty>> faulty;
+	for(int i = 0; i < 10000; ++i)
+		faulty.emplace_back(app::faulty{ i });
+	CHECK_THROWS(format_all("{0}\n", faulty.begin(), faulty.end(), { 4, 100 }), logic_error);
+
+	return test::result();
+}
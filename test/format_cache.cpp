@@ -0,0 +1,118 @@
+//
+//  format_cache.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace app
+{
+	struct value { int v; };
+	struct value_flags { int width; };
+
+	int parses = 0;
+
+	value_flags parse_format_flags(format_tag<value>, string_view flags)
+	{
+		++parses;
+		return { static_cast<int>(flags.size()) };
+	}
+
+	template<class Sink>
+	size_t to_string(const value& x, format_appender<Sink>& app, const value_flags& flags)
+	{
+		auto s = std::to_string(x.v * 100 + flags.width);
+		app.append(s);
+		return s.size();
+	}
+
+	// Formats other strings while the outer one is in use
+	struct nested { int v; };
+
+	template<class Sink>
+	size_t to_string(const nested& n, format_appender<Sink>& app)
+	{
+		auto s = format("<{0}>", n.v) + format("[{0}]", n.v);
+		app.append(s);
+		return s.size();
+	}
+}
+
+int main()
+{
+	auto& cache = format_cache::local();
+	CHECK_EQUAL(cache.capacity(), size_t(0));
+	CHECK_EQUAL(format("{0}-{1}", 1, 2), string("1-2"));
+	CHECK_EQUAL(cache.size(), size_t(0));
+	CHECK_EQUAL(cache.stats().misses, size_t(0));
+
+	// Least recently used strings are evicted
+	cache.set_capacity(2);
+	const char* a = "a{0}";
+	const char* b = "b{0}";
+	const char* c = "c{0}";
+	CHECK_EQUAL(format(a, 1), string("a1"));
+	CHECK_EQUAL(format(a, 2), string("a2"));
+	CHECK_EQUAL(format(b, 3), string("b3"));
+	CHECK_EQUAL(format(a, 4), string("a4"));
+	CHECK_EQUAL(format(c, 5), string("c5"));
+	CHECK_EQUAL(cache.stats().hits, size_t(2));
+	CHECK_EQUAL(cache.stats().misses, size_t(3));
+	CHECK_EQUAL(cache.stats().evictions, size_t(1));
+	CHECK_EQUAL(format(b, 6), string("b6"));
+	CHECK_EQUAL(cache.stats().misses, size_t(4));
+
+	// A reused buffer is parsed again, and so is a known string used with fewer arguments
+	string buffer = "x{0}";
+	CHECK_EQUAL(format(buffer.c_str(), 1), string("x1"));
+	buffer[0] = 'y';
+	CHECK_EQUAL(format(buffer.c_str(), 1), string("y1"));
+	string two = "{0}{1}";
+	CHECK_EQUAL(format(two.c_str(), 1, 2), string("12"));
+	CHECK_THROWS(format(two.c_str(), 1), runtime_error);
+
+	// The parsed flags are kept as long as the argument types are the same
+	cache.set_capacity(8);
+	string_view flagged = "{0:ab}-{1:x}-{0:abc}";
+	for(int i = 0; i < 5; ++i)
+		CHECK_EQUAL(format(flagged, app::value{ 1 }, 255), string("102-ff-103"));
+	CHECK_EQUAL(app::parses, 2);
+	CHECK_EQUAL(format(flagged, app::value{ 2 }, 255L), string("202-ff-203"));
+	CHECK_EQUAL(app::parses, 4);
+	CHECK_EQUAL(format(flagged, app::value{ 2 }, 255L), string("202-ff-203"));
+	CHECK_EQUAL(app::parses, 4);
+
+	// Flags which failed to parse are not kept
+	error_code ec;
+	string_view invalid = "{0:q}";
+	format(ec, invalid, 1);
+	CHECK(ec == format_errc::invalid_flags);
+	format(ec, invalid, 1);
+	CHECK(ec == format_errc::invalid_flags);
+
+	// Entries in use are not evicted by nested calls
+	cache.set_capacity(1);
+	CHECK(cache.size() <= 1);
+	CHECK_EQUAL(format("{0}|{0}", app::nested{ 7 }), string("<7>[7]|<7>[7]"));
+
+	// The cache belongs to the thread
+	size_t other_capacity = 1;
+	thread t([&] { other_capacity = format_cache::local().capacity(); });
+	t.join();
+	CHECK_EQUAL(other_capacity, size_t(0));
+
+	cache.set_capacity(0);
+	CHECK_EQUAL(cache.size(), size_t(0));
+
+	return test::result();
+}
@@ -0,0 +1,147 @@
+//
+//  format_error.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <list>
+#include <stdexcept>
+#include <streambuf>
+#include <system_error>
+#include <tuple>
+#include <vector>
+#include "check.hpp"
+
+// Also built with exceptions disabled, in which case the overloads taking an error_code are the only way to detect errors.
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+namespace app
+{
+	// Formats with a malformed string of its own
+	struct nested { };
+
+	template<class Sink>
+	size_t to_string(const nested&, format_appender<Sink>& app, string_view)
+	{
+		auto s = format("{1}", 1);
+		app.append(s);
+		return s.size();
+	}
+
+	struct nested_all { };
+
+	template<class Sink>
+	size_t to_string(const nested_all&, format_appender<Sink>& app, string_view)
+	{
+		vector<tuple<int>> rows(100, make_tuple(1));
+		auto s = format_all("{1}", rows.begin(), rows.end(), { 2, 10 });
+		app.append(s);
+		return s.size();
+	}
+}
+
+namespace
+{
+	// Accepts a fixed number of characters, each through overflow()
+	struct full_buf : streambuf
+	{
+		string out;
+		size_t capacity;
+		explicit full_buf(size_t n) : capacity(n) { }
+		int_type overflow(int_type ch) override
+		{
+			if(traits_type::eq_int_type(ch, traits_type::eof()) || out.size() == capacity)
+				return traits_type::eof();
+			out += traits_type::to_char_type(ch);
+			return ch;
+		}
+	};
+}
+
+int main()
+{
+	// The position is the brace opening the malformed argument
+	error_code ec;
+	CHECK_EQUAL(validate_format("a {0} b", 1, ec), size_t(7));
+	CHECK(!ec);
+	CHECK_EQUAL(validate_format("a {1} b", 1, ec), size_t(2));
+	CHECK(ec == format_errc::index_out_of_bounds);
+	CHECK_EQUAL(validate_format("ab{5}", 2, ec), size_t(2));
+	CHECK(ec == format_errc::index_out_of_bounds);
+	CHECK_EQUAL(validate_format("a } b", 1, ec), size_t(2));
+	CHECK(ec == format_errc::invalid_nesting);
+	CHECK_EQUAL(validate_format("a {0", 1, ec), size_t(2));
+	CHECK(ec == format_errc::unexpected_end);
+	CHECK_EQUAL(validate_format("{x}", 1, ec), size_t(0));
+	CHECK(ec == format_errc::invalid_index);
+	validate_format<int>("{0,z}", ec);
+	CHECK(ec == format_errc::invalid_width);
+	CHECK_EQUAL(validate_format<int>(string_view{"{0}"}, ec), size_t(3));
+	CHECK(!ec);
+	CHECK(!error_code(format_errc::invalid_flags).message().empty());
+
+	// Formatting stops at the first malformed argument
+	auto s = format(ec, "x{0}y{2}z", 1, 2);
+	CHECK(ec == format_errc::index_out_of_bounds);
+	CHECK_EQUAL(s, string("x1y"));
+	s = format(ec, "{0:q}|{1}", 1, 2);
+	CHECK(ec == format_errc::invalid_flags);
+	s = format(ec, "{0:.3f}", 1.5);
+	CHECK(!ec);
+	CHECK_EQUAL(s, string("1.500"));
+
+	// Truncated output counts only what was written
+	array<char, 4> a{};
+	CHECK_EQUAL(format(ec, in_place, a, "{0}{1}", 12, 345), size_t(4));
+	CHECK(ec == format_errc::buffer_overflow);
+	CHECK_EQUAL(string(a.begin(), a.end()), string("1234"));
+	list<char> l(4);
+	CHECK_EQUAL(format(ec, in_place, l, "{0}{1}", 12, 345), size_t(4));
+	CHECK(ec == format_errc::buffer_overflow);
+	CHECK_EQUAL(string(l.begin(), l.end()), string("1234"));
+	full_buf fb(6);
+	CHECK_EQUAL(format(ec, in_place, fb, "{0}{1,8}", 12, 345), size_t(6));
+	CHECK(ec == format_errc::write_failed);
+	CHECK_EQUAL(fb.out, string("12    "));
+	full_buf one(1);
+	CHECK_EQUAL(format(ec, in_place, one, "{0}{1}", 'a', 'b'), size_t(1));
+	CHECK(ec == format_errc::write_failed);
+	CHECK_EQUAL(one.out, string("a"));
+
+	// The cache does not keep strings which failed to parse
+	format_cache::local().set_capacity(4);
+	format(ec, "{0:q}", 5);
+	CHECK(ec == format_errc::invalid_flags);
+	format(ec, "{0:q}", 5);
+	CHECK(ec == format_errc::invalid_flags);
+	format_cache::local().set_capacity(0);
+
+	// Neither do literals
+	for(int i = 0; i < 3; ++i)
+	{
+		ec.clear();
+		format(ec, "{0:q}"_fmt, 5);
+		CHECK(ec == format_errc::invalid_flags);
+	}
+
+#if STD_FORMAT_EXCEPTIONS
+	// Throwing calls made while formatting an argument keep throwing
+	CHECK_THROWS(format(ec, "x{0}", app::nested{ }), runtime_error);
+	CHECK_THROWS(format(ec, "x{0}", app::nested_all{ }), runtime_error);
+	s = format(ec, "{0}", 1);
+	CHECK(!ec);
+	CHECK_EQUAL(s, string("1"));
+
+	CHECK_THROWS(format("{1}", 1), runtime_error);
+	CHECK_THROWS(format(in_place, a, "{0}", 123456), runtime_error);
+#endif
+
+	return test::result();
+}
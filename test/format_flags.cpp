@@ -0,0 +1,80 @@
+//
+//  format_flags.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <stdexcept>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+namespace app
+{
+	struct timestamp { long seconds; };
+	struct timestamp_flags { bool iso; bool utc; };
+
+	int parses = 0;
+
+	template<class CharT, class Traits>
+	timestamp_flags parse_format_flags(format_tag<timestamp>, basic_string_view<CharT, Traits> flags)
+	{
+		++parses;
+		string s(flags.begin(), flags.end());
+		return { s.find("iso8601") != string::npos, s.find("utc") != string::npos };
+	}
+
+	template<class Sink>
+	size_t to_string(const timestamp& t, format_appender<Sink>& app, const timestamp_flags& flags)
+	{
+		auto s = string(flags.iso ? "iso:" : "raw:") + std::to_string(t.seconds) + (flags.utc ? "Z" : "");
+		app.append(s);
+		return s.size();
+	}
+}
+
+int main()
+{
+	// format_spec of the arithmetic types
+	CHECK_EQUAL(format("{0:+}", 5), string("+5"));
+	CHECK_EQUAL(format("{0: }", 5), string(" 5"));
+	CHECK_EQUAL(format("{0:05}", -42), string("-0042"));
+	CHECK_EQUAL(format("{0:*^7}", -42), string("**-42**"));
+	CHECK_EQUAL(format("{0:<5}|", 42), string("42   |"));
+	CHECK_EQUAL(format("{0:+08.2f}", 3.14159), string("+0003.14"));
+	CHECK_EQUAL(format("{0:08}", 1.0 / 0.0), string("     inf"));
+	CHECK_EQUAL(format("{0:+.1e}", 12345.0), string("+1.2e+04"));
+	CHECK_EQUAL(format("{0:d}", 12), string("12"));
+	CHECK_THROWS(format("{0:x}", 1.5), runtime_error);
+	CHECK_THROWS(format("{0:5dd}", 1), runtime_error);
+	CHECK_THROWS(format("{0:.2}", 1), runtime_error);
+	CHECK_THROWS(format("{0:.2d}", 1), runtime_error);
+
+	// A formatter parses the flags of every argument once
+	sformatter<app::timestamp, int> f{"{0:iso8601,utc} {0} {1:+}"};
+	CHECK_EQUAL(app::parses, 2);
+	for(int i = 0; i < 100; ++i)
+		CHECK_EQUAL(f(app::timestamp{ i }, i), "iso:" + std::to_string(i) + "Z raw:" + std::to_string(i) + " +" + std::to_string(i));
+	CHECK_EQUAL(app::parses, 2);
+	auto copy = f;
+	CHECK_EQUAL(copy(app::timestamp{ 1 }, 2), string("iso:1Z raw:1 +2"));
+	CHECK_EQUAL(app::parses, 2);
+
+	// format() parses on every call
+	CHECK_EQUAL(format("{0:utc}", app::timestamp{ 3 }), string("raw:3Z"));
+	CHECK_EQUAL(format("{0:utc}", app::timestamp{ 3 }), string("raw:3Z"));
+	CHECK_EQUAL(app::parses, 4);
+
+	// Literals parse once per component
+	for(int i = 0; i < 10; ++i)
+		CHECK_EQUAL(format("{0:iso8601}"_fmt, app::timestamp{ 4 }), string("iso:4"));
+	CHECK_EQUAL(app::parses, 5);
+	CHECK_EQUAL(format("{0:+}|{1,6:.1f}"_fmt, 1, 2.25), string("+1|   2.2"));
+
+	return test::result();
+}
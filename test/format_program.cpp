@@ -0,0 +1,55 @@
+//
+//  format_program.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <utility>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+static_assert(sizeof(detail::format_instruction) == 16, "format_instruction must fit into 16 bytes");
+
+int main()
+{
+	// Arguments are reported in order with their unescaped flags
+	detail::format_program<char, char_traits<char>> program{"a{{b{1:x}}}c{0}d}}{1,5:.2f}", 2};
+	vector<pair<size_t, string>> arguments;
+	program.for_each_argument([&](size_t index, string_view flags) { arguments.emplace_back(index, string(flags.data(), flags.size())); });
+	CHECK_EQUAL(arguments.size(), size_t(3));
+	if(arguments.size() == 3)
+	{
+		CHECK(arguments[0].first == 1 && arguments[0].second == "x}");
+		CHECK(arguments[1].first == 0 && arguments[1].second.empty());
+		CHECK(arguments[2].first == 1 && arguments[2].second == ".2f");
+	}
+
+	// Static runs separated only by escaped braces become a single instruction
+	CHECK_EQUAL((detail::format_program<char, char_traits<char>>{"{{a}}{{b}}{0}", 1}.size()), size_t(2));
+	CHECK_EQUAL((detail::format_program<char, char_traits<char>>{"x{0}{{}}{0}", 1}.size()), size_t(4));
+
+	// Merged static runs, padded and unpadded arguments produce the same output as the immediate path
+	const char* fmt = "{{a}}{{b}}{0}{{{{c}}{1,6}{0,-3}x{1:.1f}{{{0,*^5}x}}";
+	sformatter<int, double> f{fmt};
+	CHECK_EQUAL(f(7, 2.5), format(fmt, 7, 2.5));
+	CHECK_EQUAL(f(7, 2.5), string("{a}{b}7{{c}   2.57  x2.5{**7**x}"));
+
+	// Long format strings with many arguments
+	string long_fmt;
+	string expected;
+	for(int i = 0; i < 10000; ++i)
+	{
+		long_fmt += "text{0,3}{1}";
+		expected += "text  12";
+	}
+	sformatter<int, int> g{long_fmt};
+	CHECK_EQUAL(g(1, 2), expected);
+
+	return test::result();
+}
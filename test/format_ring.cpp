@@ -0,0 +1,130 @@
+//
+//  format_ring.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+int main()
+{
+	format_ring ring(100);
+	CHECK_EQUAL(ring.capacity(), size_t(128));
+	CHECK(try_format(ring, "{0}-{1,5}|{2:.1f}", 42, string("ab"), 2.25));
+	{
+		auto r = ring.reserve(10);
+		CHECK(bool(r));
+		auto app = make_format_appender(r);
+		format(in_place, app, "{0}", 12345);
+		r.publish(app.write_count());
+	}
+	{
+		// Destroyed without publishing and skipped by the consumer
+		auto r = ring.reserve(3);
+	}
+	{
+		auto r = ring.reserve(2);
+		CHECK_THROWS(format(in_place, r, "{0}", 123456), runtime_error);
+	}
+	vector<string> lines;
+	auto collect = [&](string_view line) { lines.emplace_back(line.data(), line.size()); };
+	CHECK_EQUAL(ring.consume(collect), size_t(2));
+	CHECK_EQUAL(lines.size(), size_t(2));
+	if(lines.size() == 2)
+	{
+		CHECK_EQUAL(lines[0], string("42-   ab|2.2"));
+		CHECK_EQUAL(lines[1], string("12345"));
+	}
+
+	// The consumer stops at a record which is reserved but not published yet
+	lines.clear();
+	auto pending = ring.reserve(5);
+	CHECK(try_format(ring, "after"));
+	CHECK_EQUAL(ring.consume(collect), size_t(0));
+	copy_n("first", 5, pending.data());
+	pending.publish();
+	CHECK_EQUAL(ring.consume(collect), size_t(2));
+	CHECK(lines.size() == 2 && lines[0] == "first" && lines[1] == "after");
+
+	// Full and too large
+	CHECK(!try_format(ring, "{0}", string(200, 'x')));
+	int n = 0;
+	while(try_format(ring, "{0}", string(20, 'y')))
+		++n;
+	CHECK_EQUAL(n, 4);
+	CHECK_EQUAL(ring.dropped(), size_t(2));
+	CHECK_EQUAL(ring.consume(collect), size_t(4));
+
+	// Wrap around
+	for(int i = 0; i < 100; ++i)
+	{
+		CHECK(try_format(ring, "{0}:{1}", i, string(i % 40, 'w')));
+		lines.clear();
+		ring.consume(collect);
+		CHECK(lines.size() == 1 && lines[0] == std::to_string(i) + ":" + string(i % 40, 'w'));
+	}
+
+	// Several producers sharing one ring, half of them formatting into their own reservations.
+	// Records of different producers interleave but those of every single producer must arrive whole and in order.
+	format_ring shared(1 << 14);
+	const int producers = 4;
+	const int per_producer = 20000;
+	vector<thread> threads;
+	for(int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&, p] {
+			for(int i = 0; i < per_producer; )
+			{
+				bool written = false;
+				if(p % 2 == 0)
+					written = try_format(shared, "{0} {1} {2}", p, i, string(i % 23, 'p'));
+				else if(auto r = shared.reserve(64))
+				{
+					auto app = make_format_appender(r);
+					format(in_place, app, "{0} {1} {2}", p, i, string(i % 23, 'p'));
+					r.publish(app.write_count());
+					written = true;
+				}
+				if(written)
+					++i;
+				else
+					this_thread::yield();
+			}
+		});
+	}
+	vector<int> next(producers, 0);
+	int mismatches = 0;
+	for(int received = 0; received < producers * per_producer; )
+	{
+		received += static_cast<int>(shared.consume([&](string_view line) {
+			string s(line.data(), line.size());
+			int p, i;
+			if(sscanf(s.c_str(), "%d %d", &p, &i) != 2 || p < 0 || p >= producers)
+			{
+				++mismatches;
+				return;
+			}
+			mismatches += i != next[p] || s != std::to_string(p) + " " + std::to_string(i) + " " + string(i % 23, 'p');
+			++next[p];
+		}));
+	}
+	for(auto& t : threads)
+		t.join();
+	CHECK_EQUAL(mismatches, 0);
+	for(int p = 0; p < producers; ++p)
+		CHECK_EQUAL(next[p], per_producer);
+	CHECK_EQUAL(shared.consume(collect), size_t(0));
+
+	return test::result();
+}
@@ -0,0 +1,38 @@
+//
+//  formatted_size.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+int main()
+{
+	CHECK_EQUAL(formatted_size("a{0}b{1,5}c{{", 42, string("x")), size_t(11));
+	CHECK_EQUAL(formatted_size(L"{0,-4}|", 1.5), size_t(5));
+	CHECK_EQUAL(formatted_size(""), size_t(0));
+	CHECK_EQUAL(formatted_size("{0}-{0}"_fmt, 123), size_t(7));
+
+	sformatter<int, double> f{"{0}:{1}"};
+	CHECK_EQUAL(formatted_size(f, 5, 0.5), size_t(5));
+	CHECK_EQUAL(format(exact_size, f, 5, 0.5), string("5:0.5"));
+
+	// The size matches the output of every argument type
+	auto args = make_tuple(string(300, 'x'), 3.14159, -7, string_view("view"));
+	auto s = format(exact_size, "{0} and {1:.2f} {2,6}|{3,-8}|", get<0>(args), get<1>(args), get<2>(args), get<3>(args));
+	CHECK_EQUAL(s, string(300, 'x') + " and 3.14     -7|view    |");
+	CHECK_EQUAL(s.capacity(), s.size());
+	CHECK_EQUAL(formatted_size("{0} and {1:.2f} {2,6}|{3,-8}|", get<0>(args), get<1>(args), get<2>(args), get<3>(args)), s.size());
+
+	CHECK(format(exact_size, L"{0}", 12) == L"12");
+	CHECK_EQUAL(format(exact_size, allocator_arg, allocator<char>{}, "{0}", 1), string("1"));
+
+	return test::result();
+}
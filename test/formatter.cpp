@@ -0,0 +1,51 @@
+//
+//  formatter.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <sstream>
+#include <stdexcept>
+#include "allocations.hpp"
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+int main()
+{
+	sformatter<int, string, int> f{"a{0}b{{c}}{1,5}|{1,-5}|{2}"};
+	CHECK_EQUAL(f(42, "hi", 7), string("a42b{c}   hi|hi   |7"));
+	CHECK_EQUAL(format(f, 42, string("hi"), 7), string("a42b{c}   hi|hi   |7"));
+
+	ostringstream os;
+	f(os, 1, "y", 3);
+	CHECK_EQUAL(os.str(), string("a1b{c}    y|y    |3"));
+
+	auto copy = f;
+	CHECK_EQUAL(copy(5, "z", 6), string("a5b{c}    z|z    |6"));
+
+	svformatter<> empty{""};
+	CHECK_EQUAL(empty(), string());
+
+	CHECK_THROWS(sformatter<int>{"{1}"}, runtime_error);
+	CHECK_THROWS(sformatter<int>{"{0"}, runtime_error);
+
+	// Executing the program allocates nothing if the destination has room
+	sformatter<int, double, string_view> g{"{0,6}|{1:.2f}|{2,-4}|{0:+}"};
+	string out;
+	out.reserve(256);
+	auto before = test::allocations();
+	for(int i = 0; i < 100; ++i)
+	{
+		out.clear();
+		format(in_place, out, g, i, 1.5, "ab");
+	}
+	CHECK_EQUAL(test::allocations(), before);
+	CHECK_EQUAL(out, string("    99|1.50|ab  |+99"));
+
+	return test::result();
+}
@@ -0,0 +1,53 @@
+//
+//  integer.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <climits>
+#include <cstdint>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+template<class T>
+void check_to_string(T value)
+{
+	CHECK_EQUAL(format("{0}", value), std::to_string(value));
+}
+
+int main()
+{
+	CHECK_EQUAL(format("{0} {1} {2} {3} {4,6}|{5,-4}|", 0, -1, INT_MIN, ULLONG_MAX, (short)-12, (unsigned char)7),
+				string("0 -1 -2147483648 18446744073709551615    -12|7   |"));
+	CHECK_EQUAL(format("{0} {1} {2}", LLONG_MIN, 'c', true), string("-9223372036854775808 c 1"));
+	CHECK(format(L"{0}", -123) == L"-123");
+
+	// Every digit count and the values next to the powers of ten
+	for(long long v = 1, k = 0; k < 19; ++k, v *= 10)
+	{
+		check_to_string(v);
+		check_to_string(v - 1);
+		check_to_string(v + 1);
+		check_to_string(-v);
+	}
+
+	uint64_t x = 88172645463325252ull;
+	for(int i = 0; i < 100000; ++i)
+	{
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		check_to_string(static_cast<unsigned long long>(x));
+		check_to_string(static_cast<long long>(x));
+		check_to_string(static_cast<int>(x));
+		check_to_string(static_cast<unsigned>(x));
+		check_to_string(static_cast<long long>(x) >> (x & 63));
+	}
+
+	return test::result();
+}
@@ -0,0 +1,40 @@
+//
+//  literal.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <sstream>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+using namespace std::experimental::format_literals;
+
+int main()
+{
+	CHECK_EQUAL(format("a{0}b{{c}}{1,5}|{1,-5}|{2}"_fmt, 42, string("hi"), 7), string("a42b{c}   hi|hi   |7"));
+	CHECK_EQUAL(format(""_fmt), string());
+	CHECK_EQUAL(format("{{}}"_fmt), string("{}"));
+	CHECK_EQUAL(format("{0}{0}{0}"_fmt, 1), string("111"));
+	CHECK_EQUAL(format("{0}, {3}, {0}, {1}, {1}, {2}"_fmt, 1, 2, 3, 4), string("1, 4, 1, 2, 2, 3"));
+
+	// Same output as the runtime parser
+	CHECK_EQUAL(format("{0,*^7}|{1:.2f}"_fmt, 42, 3.14159), format("{0,*^7}|{1:.2f}", 42, 3.14159));
+
+	string out = "x";
+	format(in_place, out, "{0}"_fmt, 3.5);
+	CHECK_EQUAL(out, string("x3.5"));
+
+	ostringstream os;
+	format(in_place, os, "{0} {1}"_fmt, 1, string_view("os"));
+	CHECK_EQUAL(os.str(), string("1 os"));
+
+	CHECK(format(u"x{0}"_fmt, u16string_view(u"a")) == u"xa");
+	CHECK(format(L"{0}"_fmt, -3) == L"-3");
+
+	return test::result();
+}
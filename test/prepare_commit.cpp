@@ -0,0 +1,134 @@
+//
+//  prepare_commit.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	// Every character goes through overflow()
+	struct unbuffered : streambuf
+	{
+		string out;
+		int_type overflow(int_type ch) override
+		{
+			out += traits_type::to_char_type(ch);
+			return ch;
+		}
+	};
+
+	// A small put area flushed by overflow(), so windows are often too small
+	struct blocked : streambuf
+	{
+		char area[16];
+		string out;
+		blocked() { setp(area, area + sizeof(area)); }
+		int_type overflow(int_type ch) override
+		{
+			out.append(pbase(), pptr());
+			setp(area, area + sizeof(area));
+			if(ch != traits_type::eof())
+			{
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+			return 0;
+		}
+		string str() const { return out + string(pbase(), pptr()); }
+	};
+
+	const char* fmt = "{0} {1} {2:.3f} {3,6} {4,-4}| {5}";
+	const string long_arg(100, 'z');
+	const string expected = "-123456789 1.5 2.000     42 7   | " + long_arg;
+
+	template<class Destination>
+	void format_into(Destination& dest)
+	{
+		format(in_place, dest, fmt, -123456789, 1.5, 2.0, 42, 7, long_arg);
+	}
+}
+
+int main()
+{
+	// The same output through every kind of window and the fallbacks
+	string s;
+	s.reserve(1000);
+	format_into(s);
+	CHECK_EQUAL(s, expected);
+
+	vector<char> v;
+	auto it = back_inserter(v);
+	format_into(it);
+	CHECK_EQUAL(string(v.begin(), v.end()), expected);
+
+	array<char, 200> arr{};
+	auto app = make_format_appender(arr);
+	format_into(app);
+	CHECK_EQUAL(app.write_count(), expected.size());
+	CHECK_EQUAL(string(arr.data(), expected.size()), expected);
+
+	stringbuf sb;
+	format_into(sb);
+	CHECK_EQUAL(sb.str(), expected);
+
+	unbuffered ub;
+	format_into(ub);
+	CHECK_EQUAL(ub.out, expected);
+
+	blocked bb;
+	format_into(bb);
+	CHECK_EQUAL(bb.str(), expected);
+
+	list<char> l;
+	auto lit = back_inserter(l);
+	format(in_place, lit, "{0} {1}", 12345, 0.25);
+	CHECK_EQUAL(string(l.begin(), l.end()), string("12345 0.25"));
+
+	ostringstream os;
+	os << "x";
+	format(in_place, os, "{0}{1}", 99, 1e100);
+	CHECK_EQUAL(os.str(), string("x991e+100"));
+
+	detail::small_buffer<wchar_t, 4> small;
+	auto small_app = make_format_appender(small);
+	format(in_place, small_app, L"{0}|{1}", 1234567890, 0.5);
+	CHECK(wstring(small.data(), small.size()) == L"1234567890|0.5");
+
+	array<char, 4> tiny{};
+	auto tiny_app = make_format_appender(tiny);
+	CHECK_THROWS(format(in_place, tiny_app, "{0}", 123456), runtime_error);
+
+	// A string window uses the reserved capacity and never grows the string
+	string t = "ab";
+	t.reserve(64);
+	auto string_app = make_format_appender(t);
+	auto window = string_app.prepare(10);
+	CHECK(window != nullptr);
+	if(window)
+	{
+		window[0] = 'c';
+		window[1] = 'd';
+		string_app.commit(2);
+	}
+	CHECK_EQUAL(t, string("abcd"));
+	CHECK_EQUAL(string_app.write_count(), size_t(2));
+	string u;
+	auto empty_app = make_format_appender(u);
+	CHECK(empty_app.prepare(u.capacity() + 1) == nullptr);
+
+	return test::result();
+}
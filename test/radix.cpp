@@ -0,0 +1,87 @@
+//
+//  radix.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace
+{
+	string printf_string(const char* fmt, unsigned long long value)
+	{
+		char buffer[80];
+		snprintf(buffer, sizeof(buffer), fmt, value);
+		return buffer;
+	}
+
+	string binary_string(unsigned long long value)
+	{
+		string digits;
+		do
+			digits.insert(digits.begin(), static_cast<char>('0' + (value & 1)));
+		while(value >>= 1);
+		return digits;
+	}
+}
+
+int main()
+{
+	CHECK_EQUAL(format("{0:x}", 255), string("ff"));
+	CHECK_EQUAL(format("{0:X}", 0xDEADBEEF), string("DEADBEEF"));
+	CHECK_EQUAL(format("{0:x}", 0), string("0"));
+	CHECK_EQUAL(format("{0:#x}", 0), string("0x0"));
+	CHECK_EQUAL(format("{0:o}", 8), string("10"));
+	CHECK_EQUAL(format("{0:#o}", 511), string("0o777"));
+	CHECK_EQUAL(format("{0:b}", 5), string("101"));
+	CHECK_EQUAL(format("{0:#b}", 5u), string("0b101"));
+	CHECK_EQUAL(format("{0:x}", -255), string("-ff"));
+	CHECK_EQUAL(format("{0:#010x}", -255), string("-0x00000ff"));
+	CHECK_EQUAL(format("{0:#010X}", 255), string("0X000000FF"));
+	CHECK_EQUAL(format("{0:08b}", static_cast<unsigned char>(5)), string("00000101"));
+	CHECK_EQUAL(format("{0:+x}", 10), string("+a"));
+	CHECK_EQUAL(format("{0:*<#8x}", 10), string("0xa*****"));
+	CHECK_EQUAL(format("{0:x}", INT64_MIN), string("-8000000000000000"));
+	CHECK_EQUAL(format("{0:x}", static_cast<short>(-32768)), string("-8000"));
+	CHECK_EQUAL(format("{0:o}", UINT64_MAX), string("1777777777777777777777"));
+	CHECK_EQUAL(format("{0:b}", UINT64_MAX), string(64, '1'));
+#ifdef __SIZEOF_INT128__
+	CHECK_EQUAL(format("{0:x}", ~static_cast<unsigned __int128>(0)), string(32, 'f'));
+	CHECK_EQUAL(format("{0:#b}", static_cast<__int128>(-1)), string("-0b1"));
+	CHECK_EQUAL(format("{0:#b}", static_cast<__int128>(static_cast<unsigned __int128>(1) << 127)), "-0b1" + string(127, '0'));
+#endif
+	CHECK(format(L"{0:#x}", 4096) == L"0x1000");
+	CHECK(format(u"{0:X}", 48879) == u"BEEF");
+
+	// Every digit count, compared with printf
+	mt19937_64 rng(25);
+	for(int i = 0; i < 20000; ++i)
+	{
+		auto value = rng() >> (rng() % 64);
+		CHECK_EQUAL(format("{0:x}", value), printf_string("%llx", value));
+		CHECK_EQUAL(format("{0:X}", value), printf_string("%llX", value));
+		CHECK_EQUAL(format("{0:o}", value), printf_string("%llo", value));
+		CHECK_EQUAL(format("{0:b}", value), binary_string(value));
+		CHECK_EQUAL(format("{0:#x}", static_cast<unsigned>(value)), "0x" + printf_string("%llx", static_cast<unsigned>(value)));
+	}
+
+	static constexpr checked_format<int> checked{"{0:#06x}"};
+	CHECK_EQUAL(format(checked, 31), string("0x001f"));
+	array<char, 16> a{};
+	format(in_place, a, "{0:x}", 0xabc);
+	CHECK_EQUAL(string(a.data(), 3), string("abc"));
+
+	return test::result();
+}
@@ -0,0 +1,139 @@
+//
+//  transcoding_sink.cpp
+//  std-format
+//
+//  Created by knejp on 18.2.14.
+//  Copyright (c) 2014 Miro Knejp. All rights reserved.
+//
+
+#include <std-format/format.hpp>
+#include <sstream>
+#include <string>
+#include "check.hpp"
+
+using namespace std;
+using namespace std::experimental;
+
+namespace app
+{
+	// Appends a surrogate pair one code unit at a time
+	struct split_pair { };
+
+	template<class Sink>
+	size_t to_string(const split_pair&, format_appender<Sink>& app, u16string_view)
+	{
+		app.append(char16_t(0xD83D));
+		app.append(char16_t(0xDE00));
+		return 2;
+	}
+}
+
+namespace
+{
+	// The same text in every encoding, with sequences of every length and ASCII runs longer than a block
+	const string utf8 = "ab\xC3\xA4" "cdefghijklmnopqrstu\xE2\x82\xAC" "v\xF0\x9F\x98\x80" "wxyz0123456789abcdef\xC3\xA9";
+	const u16string utf16 = u"ab\x00e4" u"cdefghijklmnopqrstu\x20ac" u"v\xD83D\xDE00" u"wxyz0123456789abcdef\x00e9";
+	const u32string utf32 = U"ab\x00e4" U"cdefghijklmnopqrstu\x20ac" U"v\U0001F600" U"wxyz0123456789abcdef\x00e9";
+
+	// Append \p text in fragments split at \p first and \p second, which may fall inside a sequence
+	template<class CharT, class Dest>
+	void append_split(Dest& dest, const basic_string<CharT>& text, size_t first, size_t second)
+	{
+		auto sink = make_transcoding_sink<CharT>(dest);
+		format(in_place, sink, text.substr(0, first));
+		format(in_place, sink, text.substr(first, second - first));
+		format(in_place, sink, text.substr(second));
+		CHECK(!sink.incomplete());
+	}
+
+	template<class CharT, class Dest>
+	void check_every_split(const basic_string<CharT>& text, const Dest& expected)
+	{
+		int mismatches = 0;
+		for(size_t first = 0; first <= text.size(); ++first)
+		{
+			for(size_t second = first; second <= text.size(); ++second)
+			{
+				Dest dest;
+				append_split(dest, text, first, second);
+				mismatches += dest != expected;
+			}
+		}
+		CHECK_EQUAL(mismatches, 0);
+	}
+}
+
+int main()
+{
+	// Fragments split at every pair of positions convert to the same output as the whole text
+	check_every_split(utf8, utf16);
+	check_every_split(utf8, utf32);
+	check_every_split(utf16, utf8);
+	check_every_split(utf16, utf32);
+	check_every_split(utf32, utf8);
+	check_every_split(utf32, utf16);
+
+	// Arguments and padding are converted as well
+	string out;
+	auto sink = make_transcoding_sink<char16_t>(out);
+	format(in_place, sink, u"{0}: {1} \x00e9\x20ac {2,5}|", 42, u16string(u"n\x00e4me"), 1.5);
+	CHECK_EQUAL(out, string("42: n\xC3\xA4me \xC3\xA9\xE2\x82\xAC   1.5|"));
+
+	// Long mixed text across the stack chunks
+	u16string big;
+	string expected;
+	for(int i = 0; i < 200; ++i)
+	{
+		big += u"abcdefghijklmnop\x00e9";
+		expected += "abcdefghijklmnop\xC3\xA9";
+	}
+	out.clear();
+	format(in_place, sink, u"{0}", big);
+	CHECK_EQUAL(out, expected);
+	u32string big32(big.begin(), big.end());
+	out.clear();
+	auto sink32 = make_transcoding_sink<char32_t>(out);
+	format(in_place, sink32, U"{0}", big32);
+	CHECK_EQUAL(out, expected);
+	u32string back;
+	auto sink8 = make_transcoding_sink<char>(back);
+	format(in_place, sink8, expected);
+	CHECK(back == big32);
+
+	// A surrogate pair split between appends of one argument
+	out.clear();
+	format(in_place, sink, u"<{0}>", app::split_pair{ });
+	CHECK_EQUAL(out, string("<\xF0\x9F\x98\x80>"));
+
+	// A surrogate pair split between format calls is held back until it is complete
+	out.clear();
+	format(in_place, sink, u16string(1, char16_t(0xD83D)));
+	CHECK(out.empty());
+	CHECK(sink.incomplete());
+	format(in_place, sink, u16string(1, char16_t(0xDE00)));
+	CHECK_EQUAL(out, string("\xF0\x9F\x98\x80"));
+	CHECK(!sink.incomplete());
+
+	// Unpaired surrogates and malformed UTF-8 become replacement characters
+	out.clear();
+	format(in_place, sink, u16string{ char16_t(0xDC00), u'x', char16_t(0xD800), u'y' });
+	CHECK_EQUAL(out, string("\xEF\xBF\xBDx\xEF\xBF\xBDy"));
+	u16string u16;
+	auto sink16 = make_transcoding_sink<char>(u16);
+	format(in_place, sink16, "\xFF" "a\xE2");
+	format(in_place, sink16, "b");
+	CHECK(u16 == u"\xFFFD" u"a\xFFFD" u"b");
+
+	// Non-ASCII fill into a stream
+	ostringstream os;
+	auto stream_sink = make_transcoding_sink<char32_t>(os);
+	format(in_place, stream_sink, U"{0,\x00e9^5}", 1);
+	CHECK_EQUAL(os.str(), string("\xC3\xA9\xC3\xA9" "1\xC3\xA9\xC3\xA9"));
+
+	string from_wide;
+	auto wide_sink = make_transcoding_sink<wchar_t>(from_wide);
+	format(in_place, wide_sink, L"{0} \x00fc", wstring(L"x"));
+	CHECK_EQUAL(from_wide, string("x \xC3\xBC"));
+
+	return test::result();
+}